@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include "affinity.h"
+#include "space.h"
+#include "cell.h"
+#include "info.h"
+#include "mympi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <mpi.h>
+
+#define CPUPATH "/sys/devices/system/cpu"
+
+// 读取sysfs文件中的一个整数, 失败时返回-1
+static int readSysInt(const char* path){
+
+	int value = -1;
+	FILE* f = fopen(path, "r");
+	if (f){
+		if (fscanf(f, "%d", &value) != 1)
+			value = -1;
+		fclose(f);
+	}
+	return value;
+}
+
+// 解析sysfs中的处理器列表(如 0-3,8,10-11)
+static void readCpuList(const char* path, cpu_set_t* set){
+
+	CPU_ZERO(set);
+	FILE* f = fopen(path, "r");
+	if (! f)
+		return;
+
+	int first, last;
+	while (fscanf(f, "%d", &first) == 1){
+		last = first;
+		int c = fgetc(f);
+		if (c == '-'){
+			if (fscanf(f, "%d", &last) != 1)
+				break;
+			c = fgetc(f);
+		}
+		for (int i = first; i <= last && i < CPU_SETSIZE; i++)
+			CPU_SET(i, set);
+		if (c != ',')
+			break;
+	}
+	fclose(f);
+}
+
+// 处理器所用末级缓存的编号: 取级别最高的缓存, 没有id文件时以共享该缓存的第一个处理器代替
+static int lastCacheId(int cpu){
+
+	char path[128];
+	int id = -1;
+	int topLevel = -1;
+	for (int k = 0; ; k++){
+
+		snprintf(path, sizeof(path), CPUPATH "/cpu%d/cache/index%d/level", cpu, k);
+		int level = readSysInt(path);
+		if (level < 0)
+			break;
+		if (level < topLevel)
+			continue;
+		topLevel = level;
+
+		snprintf(path, sizeof(path), CPUPATH "/cpu%d/cache/index%d/id", cpu, k);
+		id = readSysInt(path);
+		if (id < 0){
+			cpu_set_t shared;
+			snprintf(path, sizeof(path), CPUPATH "/cpu%d/cache/index%d/shared_cpu_list", cpu, k);
+			readCpuList(path, &shared);
+			for (int i = 0; i < CPU_SETSIZE && id < 0; i++)
+				if (CPU_ISSET(i, &shared))
+					id = i;
+		}
+	}
+	return id;
+}
+
+// 读取allowed中各处理器的拓扑位置, 返回处理器数
+static int readTopology(const cpu_set_t* allowed, CpuInfo** list){
+
+	int num = 0;
+	*list = (CpuInfo*)malloc(CPU_COUNT(allowed)*sizeof(CpuInfo));
+
+	char path[128];
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (! CPU_ISSET(cpu, allowed))
+			continue;
+
+		CpuInfo* info = &(*list)[num++];
+		info->cpu = cpu;
+
+		snprintf(path, sizeof(path), CPUPATH "/cpu%d/topology/physical_package_id", cpu);
+		info->package = readSysInt(path);
+		snprintf(path, sizeof(path), CPUPATH "/cpu%d/topology/core_id", cpu);
+		info->core = readSysInt(path);
+		info->cache = lastCacheId(cpu);
+
+		// 超线程中的序号: 同一物理核中编号更小的处理器数
+		cpu_set_t siblings;
+		snprintf(path, sizeof(path), CPUPATH "/cpu%d/topology/thread_siblings_list", cpu);
+		readCpuList(path, &siblings);
+		info->thread = 0;
+		for (int i = 0; i < cpu; i++)
+			if (CPU_ISSET(i, &siblings))
+				info->thread++;
+
+		// 读不到拓扑时把每个处理器看作单独的核
+		if (info->core < 0)
+			info->core = cpu;
+	}
+	return num;
+}
+
+// 紧凑绑定的顺序: 先用完各物理核的第一个超线程, 物理核按插槽、末级缓存依次排列
+static int compareCpu(const void* a, const void* b){
+
+	const CpuInfo* x = (const CpuInfo*)a;
+	const CpuInfo* y = (const CpuInfo*)b;
+	if (x->thread != y->thread) return x->thread - y->thread;
+	if (x->package != y->package) return x->package - y->package;
+	if (x->cache != y->cache) return x->cache - y->cache;
+	if (x->core != y->core) return x->core - y->core;
+	return x->cpu - y->cpu;
+}
+
+// 按mode绑定各进程, 须在空间分解之后由所有进程一同调用, 完成后打印绑定结果
+// 共享内存通信要求所有进程在同一节点上, 因此在整个MPI_COMM_WORLD中统一分配处理器
+int bindRanks(const char* mode, struct SpacialStr* space){
+
+	if (strcmp(mode, "none") == 0)
+		return 1;
+	if (strcmp(mode, "compact") != 0)
+		return 0;
+
+	// 可用的处理器为各进程当前允许使用的处理器的并集(mpirun可能已将各进程绑定到不同的处理器)
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(cpu_set_t), &allowed);
+	MPI_Allreduce(MPI_IN_PLACE, &allowed, sizeof(cpu_set_t), MPI_BYTE, MPI_BOR, MPI_COMM_WORLD);
+
+	CpuInfo* cpus = NULL;
+	int cpuNum = readTopology(&allowed, &cpus);
+	qsort(cpus, cpuNum, sizeof(CpuInfo), compareCpu);
+
+	// 本进程在进程网格Morton顺序中的序号, 网格中相邻的进程序号相近, 从而落在相邻的物理核上
+	int* p = space->globalProcNum;
+	int myRank = getMyRank();
+	uint64_t myKey = mortonKey(space->position[0], space->position[1], space->position[2]);
+	int order = 0;
+	for (int r = 0; r < getRankNums(); r++){
+		uint64_t key = mortonKey(r%p[0], (r/p[0])%p[1], r/(p[0]*p[1]));
+		if (key < myKey || (key == myKey && r < myRank))
+			order++;
+	}
+
+	// 进程数超过处理器数时循环使用
+	int record[6] = {-1, -1, -1, -1, -1, 0};
+	if (cpuNum > 0){
+		CpuInfo* mine = &cpus[order%cpuNum];
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(mine->cpu, &set);
+		record[0] = mine->cpu;
+		record[1] = mine->package;
+		record[2] = mine->cache;
+		record[3] = mine->core;
+		record[4] = mine->thread;
+		record[5] = sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+	}
+
+	// 拓扑概况: 物理核数及其中不同的末级缓存、插槽数(排序后第一个超线程的各物理核在最前面)
+	int counts[4] = {cpuNum, 0, 0, 0};
+	for (int i = 0; i < cpuNum && cpus[i].thread == 0; i++){
+		counts[1]++;
+		if (i == 0 || cpus[i].package != cpus[i-1].package){
+			counts[3]++;
+			counts[2]++;
+		}
+		else if (cpus[i].cache != cpus[i-1].cache)
+			counts[2]++;
+	}
+
+	int* map = ifZeroRank() ? (int*)malloc(6*getRankNums()*sizeof(int)) : NULL;
+	MPI_Gather(record, 6, MPI_INT, map, 6, MPI_INT, 0, MPI_COMM_WORLD);
+	printAffinity(stdout, space, counts, map);
+
+	free(map);
+	free(cpus);
+	return 1;
+}
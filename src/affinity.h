@@ -0,0 +1,27 @@
+// affinity.h
+// 进程绑定: 读取/sys/devices/system/cpu中的处理器拓扑, 将各进程紧凑地绑定到物理核上,
+// 进程网格中相邻的进程尽量放在共享同一末级缓存的核上
+
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+struct SpacialStr;
+
+// 逻辑处理器在拓扑中的位置
+typedef struct CpuInfoStr{
+
+	int cpu;      // 逻辑处理器编号
+	int package;  // 所在插槽
+	int cache;    // 末级缓存编号, 共享同一末级缓存的处理器相同
+	int core;     // 物理核编号(插槽内)
+	int thread;   // 在物理核的超线程中的序号
+
+}CpuInfo;
+
+// 按mode绑定各进程, 须在空间分解之后由所有进程一同调用, 完成后打印绑定结果
+// none: 不绑定(由mpirun决定); compact: 按进程网格的Morton顺序依次绑定到各物理核,
+// 物理核按插槽、末级缓存排列, 进程数超过物理核数时再使用超线程
+// mode无法识别时返回0
+int bindRanks(const char* mode, struct SpacialStr* space);
+
+#endif
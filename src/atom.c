@@ -9,6 +9,7 @@
 #include "random.h"
 #include "info.h"
 #include "mympi.h"
+#include "memory.h"
 
 #include <stdlib.h>
 #include <math.h>
@@ -16,25 +17,47 @@
 #include <string.h>
 #include <mpi.h>
 
-static void dataToSmBuf(struct SystemStr* sys);
+static int dataToSmBuf(struct SystemStr* sys);
 static void processSmData(struct SystemStr* sys, void *smbuf, enum Neighbor dimen);
 
+// 为slotNum个槽位分配原子数组, 按设置的页类型分配(见memory.h)
+static void allocAtomArrays(Atom* atoms, int slotNum){
+
+   	atoms->pos = (double3*) allocBlock(slotNum*sizeof(double3));
+   	atoms->momenta = (double3*) allocBlock(slotNum*sizeof(double3));
+   	atoms->force = (double3*) allocBlock(slotNum*sizeof(double3));
+   	atoms->pot = (double*)allocBlock(slotNum*sizeof(double));
+   	atoms->id = (bigint*)allocBlock(slotNum*sizeof(bigint));
+   	atoms->type = (int*)allocBlock(slotNum*sizeof(int));
+   	for (int j = 0; j < 3; j++)
+   		atoms->relPos[j] = (float*) allocBlock(slotNum*sizeof(float));
+}
+
+// 释放原子数组
+static void freeAtomArrays(Atom* atoms){
+
+    freeBlock(atoms->pos);
+    freeBlock(atoms->momenta);
+    freeBlock(atoms->force);
+    freeBlock(atoms->pot);
+    freeBlock(atoms->id);
+    freeBlock(atoms->type);
+    for (int j = 0; j < 3; j++)
+        freeBlock(atoms->relPos[j]);
+}
+
 // 初始化原子信息结构体
 void initAtoms(struct CellStr* cells, Atom** ato){
 
 	*ato = (Atom*)malloc(sizeof(Atom));
     Atom* atoms = *ato;
 
-   	int maxAtomNum = MAXPERCELL*cells->totalCellNum;
+   	int maxAtomNum = cells->slotNum;
 	
 	atoms->myNum = 0;
    	atoms->totalNum = 0;
 
-   	atoms->pos = (double3*) malloc(maxAtomNum*sizeof(double3));
-   	atoms->momenta = (double3*) malloc(maxAtomNum*sizeof(double3));
-   	atoms->force = (double3*) malloc(maxAtomNum*sizeof(double3));
-   	atoms->pot = (double*)malloc(maxAtomNum*sizeof(double));
-   	atoms->id = (int*)malloc(maxAtomNum*sizeof(int));
+   	allocAtomArrays(atoms, maxAtomNum);
 
    	for (int i = 0; i < maxAtomNum; i++)
    	{
@@ -42,13 +65,154 @@ void initAtoms(struct CellStr* cells, Atom** ato){
       		atoms->pos[i][j] = 0.0;
       		atoms->momenta[i][j] = 0.0;
       		atoms->force[i][j] = 0.0;
+      		atoms->relPos[j][i] = 0.0f;
       	}
       	atoms->pot[i] = 0.0;
       	atoms->id[i] = 0;
+      	atoms->type[i] = 0;
    	}
 }
 
+// 释放原子信息结构体
+void freeAtoms(Atom* atoms){
+
+    if (! atoms)
+        return;
+    freeAtomArrays(atoms);
+    free(atoms);
+}
+
+// 按新的槽位数重新划分各细胞, 并将原子数据搬移至新的位置, 已记录的通信槽位随之更新
+static void relayoutCells(struct SystemStr* sys, int* capacity){
+
+    Cell* cells = sys->cells;
+    Atom old = *sys->atoms;
+
+    int oldSlotNum = cells->slotNum;
+    int* oldStart = (int*)malloc((cells->totalCellNum+1)*sizeof(int));
+    memcpy(oldStart, cells->cellStart, (cells->totalCellNum+1)*sizeof(int));
+
+    layoutCells(cells, capacity);
+    allocAtomArrays(sys->atoms, cells->slotNum);
+    Atom* atoms = sys->atoms;
+
+    // 旧槽位对应的新槽位, 空槽位为-1(只可能出现在下次交换前就会清空的过期记录中)
+    int* slotMap = (int*)malloc(oldSlotNum*sizeof(int));
+    for (int i = 0; i < oldSlotNum; i++)
+        slotMap[i] = -1;
+
+    for (int nCell = 0; nCell < cells->totalCellNum; nCell++)
+        for (int count = 0; count < cells->atomNum[nCell]; count++)
+        {
+            int n1 = oldStart[nCell] + count;
+            int n2 = cells->cellStart[nCell] + count;
+            for (int i = 0; i < 3; i++){
+                atoms->pos[n2][i] = old.pos[n1][i];
+                atoms->momenta[n2][i] = old.momenta[n1][i];
+                atoms->force[n2][i] = old.force[n1][i];
+            }
+            atoms->pot[n2] = old.pot[n1];
+            atoms->id[n2] = old.id[n1];
+            atoms->type[n2] = old.type[n1];
+            slotMap[n1] = n2;
+        }
+
+    if (sys->datacomm)
+        remapCommSlots(sys->datacomm, slotMap);
+
+    freeAtomArrays(&old);
+    free(slotMap);
+    free(oldStart);
+}
+
+// 细胞中的槽位已用完时扩容: 各细胞的槽位数至少为按当前原子数应分配的数量, 已有的槽位不减少
+// 已满的细胞(包括未分配槽位的真空细胞)总是获得余量
+static void growCells(struct SystemStr* sys){
+
+    Cell* cells = sys->cells;
+    int* capacity = (int*)malloc(cells->totalCellNum*sizeof(int));
+    cellCapacities(cells, cells->atomNum, capacity);
+    for (int i = 0; i < cells->totalCellNum; i++){
+        int cap = cells->cellStart[i+1] - cells->cellStart[i];
+        int need = cells->atomNum[i] == cap ? cellCapacity(cap) : capacity[i];
+        capacity[i] = need > cap ? need : cap;
+    }
+    relayoutCells(sys, capacity);
+    free(capacity);
+}
+
+// 按各细胞将放入的原子数count(含已有原子)划分槽位, count会被修改
+// 通信区域的细胞按最近的本空间细胞的原子数预留槽位, 真空区域的细胞不占槽位
+static void reserveSlots(struct SystemStr* sys, int* count){
+
+    Cell* cells = sys->cells;
+    int* capacity = (int*)malloc(cells->totalCellNum*sizeof(int));
+
+    int* n = cells->xyzCellNum;
+    for (int i = cells->myCellNum; i < cells->totalCellNum; i++){
+        int3 xyz;
+        getXYZByCell(cells, xyz, i);
+        for (int d = 0; d < 3; d++)
+            xyz[d] = xyz[d] < 0 ? 0 : (xyz[d] >= n[d] ? n[d]-1 : xyz[d]);
+        int near = count[findCellByXYZ(cells, xyz)];
+        if (count[i] < near)
+            count[i] = near;
+    }
+    cellCapacities(cells, count, capacity);
+    relayoutCells(sys, capacity);
+    free(capacity);
+}
+
+// 将一组原子放入各细胞中: 先统计各细胞的原子数, 按此划分槽位后再依次放入
+void placeAtoms(struct SystemStr* sys, struct atomDataStr* list, int num){
+
+    Cell* cells = sys->cells;
+    int* count = (int*)malloc(cells->totalCellNum*sizeof(int));
+    for (int i = 0; i < cells->totalCellNum; i++)
+        count[i] = cells->atomNum[i];
+
+    for (int k = 0; k < num; k++)
+        count[findCellByCoord(cells, sys->space, list[k].pos)]++;
+
+    reserveSlots(sys, count);
+    free(count);
+
+    for (int k = 0; k < num; k++)
+        assignAtom(list[k].id, list[k].type, list[k].pos, sys, list[k].momenta);
+}
+
+// 晶格位置在一个方向上的坐标: 晶胞序号, 在晶胞中位于前半(0.25)或后半(0.75), 以及所在的本空间细胞坐标
+typedef struct LatticeLineStr{
+
+    int index;
+    int half;
+    int cell;
+    double pos;
+
+}LatticeLine;
+
+// 求[begin, end)个晶胞中落在本空间[myMin, myMax)内的晶格坐标, 按half分为两组, 返回各组的个数
+static void latticeLine(int begin, int end, double latticeConst, double myMin, double myMax,
+    double cellLength, int cellNum, LatticeLine* line[2], int num[2]){
+
+    num[0] = num[1] = 0;
+    for (int i = begin; i < end; i++)
+        for (int h = 0; h < 2; h++)
+        {
+            double pos = (i + 0.25 + 0.5*h) * latticeConst;
+            if (pos < myMin || pos >= myMax)
+                continue;
+            int c = (int)floor((pos - myMin)/cellLength);
+            LatticeLine* l = &line[h][num[h]++];
+            l->index = i;
+            l->half = h;
+            l->cell = c < cellNum ? c : cellNum-1;
+            l->pos = pos;
+        }
+}
+
 // 分配各原子到对应的细胞中
+// 晶格位置的细胞由各方向的细胞坐标直接求出: 先统计各细胞的原子数并划分槽位, 再将原子直接写入槽位
 void distributeAtoms(struct SystemStr* sys, struct ParameterStr* para){
  
    	double latticeConst = sys->lattice->latticeConst;
@@ -56,63 +220,84 @@ void distributeAtoms(struct SystemStr* sys, struct ParameterStr* para){
    	int zLat = para->zLat;
    	double* myMin = sys->space->myMin;
    	double* myMax = sys->space->myMax;
+   	Cell* cells = sys->cells;
+   	Atom* atoms = sys->atoms;
 
-   	double3 xyzpos;  // 原子坐标
-
-   	double3 momenta; // 原子动量
-   	momenta[0] = 0.0;
-   	momenta[1] = 0.0;
-   	momenta[2] = 0.0;
-   
    	int n = 4;  // 每个晶胞4个原子
-   	double3 displace[4] = { {0.25, 0.25, 0.25},
-      	{0.25, 0.75, 0.75},
-      	{0.75, 0.25, 0.75},
-      	{0.75, 0.75, 0.25} };
-
-   	// 分配原子
-   	int begin[3];
-   	int end[3];
+   	// 面心立方的4个基元中x, y方向的位置决定z方向的位置(hz = hx^hy)及基元序号
+   	int basis[2][2] = { {0, 1}, {2, 3} };
+
+   	// 各方向上落在本空间中的晶格坐标
+   	LatticeLine* line[3][2];
+   	int lineNum[3][2];
    	for (int i = 0; i < 3; i++)
    	{
-      	begin[i] = floor(myMin[i]/latticeConst);
-      	end[i]   = ceil (myMax[i]/latticeConst);
+      	int begin = floor(myMin[i]/latticeConst);
+      	int end   = ceil (myMax[i]/latticeConst);
+      	for (int h = 0; h < 2; h++)
+      		line[i][h] = (LatticeLine*)malloc((end - begin + 1)*sizeof(LatticeLine));
+      	latticeLine(begin, end, latticeConst, myMin[i], myMax[i],
+      		cells->cellLength[i], cells->xyzCellNum[i], line[i], lineNum[i]);
+   	}
+
+   	// 第一遍统计各细胞的原子数, 第二遍将原子写入槽位
+   	int* count = (int*)calloc(cells->totalCellNum, sizeof(int));
+   	for (int fill = 0; fill < 2; fill++)
+   	{
+   		for (int hx = 0; hx < 2; hx++)
+   		for (int hy = 0; hy < 2; hy++)
+   		{
+   			int hz = hx ^ hy;
+   			int ib = basis[hx][hy];
+   			for (int kx = 0; kx < lineNum[0][hx]; kx++)
+   			for (int ky = 0; ky < lineNum[1][hy]; ky++)
+   			{
+   				LatticeLine* lx = &line[0][hx][kx];
+   				LatticeLine* ly = &line[1][hy][ky];
+   				bigint base = zLat*(ly->index + (bigint)yLat*lx->index);
+   				for (int kz = 0; kz < lineNum[2][hz]; kz++)
+   				{
+   					LatticeLine* lz = &line[2][hz][kz];
+   					int3 xyz = {lx->cell, ly->cell, lz->cell};
+   					int cell = findCellByXYZ(cells, xyz);
+   					if (! fill){
+   						count[cell]++;
+   						continue;
+   					}
+
+   					// 计算原子的id, 初始化动量为0
+   					bigint id = ib + n*(lz->index + base);
+   					int slot = cells->cellStart[cell] + cells->atomNum[cell]++;
+   					atoms->id[slot] = id;
+   					atoms->type[slot] = siteType(sys->lattice, ib, id);
+   					atoms->pos[slot][0] = lx->pos;
+   					atoms->pos[slot][1] = ly->pos;
+   					atoms->pos[slot][2] = lz->pos;
+   					for (int i = 0; i < 3; i++)
+   						atoms->momenta[slot][i] = 0.0;
+   				}
+   			}
+   		}
+
+   		if (! fill)
+   			reserveSlots(sys, count);
    	}
+   	free(count);
+   	for (int i = 0; i < 3; i++)
+   		for (int h = 0; h < 2; h++)
+   			free(line[i][h]);
 
-   	for (int ix=begin[0]; ix<end[0]; ++ix)
-      	for (int iy=begin[1]; iy<end[1]; ++iy)
-         	for (int iz=begin[2]; iz<end[2]; ++iz)
-            	for (int ib=0; ib<n; ++ib)
-            	{
-               		double xpos = (ix+displace[ib][0]) * latticeConst;
-               		double ypos = (iy+displace[ib][1]) * latticeConst;
-               		double zpos = (iz+displace[ib][2]) * latticeConst;
-               		if (xpos < myMin[0] || xpos >= myMax[0]) continue;
-               		if (ypos < myMin[1] || ypos >= myMax[1]) continue;
-               		if (zpos < myMin[2] || zpos >= myMax[2]) continue;
-
-               		// 计算原子的id
-               		int id = ib+n*(iz+zLat*(iy+yLat*(ix)));
-
-               		xyzpos[0] = xpos;
-               		xyzpos[1] = ypos;
-               		xyzpos[2] = zpos;
-
-               		// 将此原子置于对应的细胞中,并初始化动量为0
-               		assignAtom(id, xyzpos, sys, momenta);
-            	}
+   	atoms->myNum = 0;
+   	for (int i = 0; i < cells->myCellNum; i++)
+   		atoms->myNum += cells->atomNum[i];
 
    	// 利用mpi的reduce计算所有进程的总原子数量
-   	//beginTimer(reduce);
-   	MPI_Allreduce(&sys->atoms->myNum, &sys->atoms->totalNum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-   	//endTimer(reduce);
-    //printTotalAtom(stdout,sys->atoms);
-
-   	//assert(s->atoms->nGlobal == nb*nx*ny*nz);
+   	bigint myNum = atoms->myNum;
+   	MPI_Allreduce(&myNum, &atoms->totalNum, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
 }
 
-// 将指定原子分配到对应的细胞中
-void assignAtom(int id, double3 xyzpos, struct SystemStr* sys, double3 momenta){
+// 将指定原子分配到对应的细胞中, 返回原子所在的槽位
+int assignAtom(bigint id, int type, double3 xyzpos, struct SystemStr* sys, double3 momenta){
     
     // 根据原子坐标找到对应的细胞
     int cell = findCellByCoord(sys->cells, sys->space, xyzpos);
@@ -120,8 +305,12 @@ void assignAtom(int id, double3 xyzpos, struct SystemStr* sys, double3 momenta){
     // if(getMyRank()==2){
     //     printf("cell :%d\n",cell );
     // }
+    // 细胞已满时扩容
+    if (sys->cells->atomNum[cell] == sys->cells->cellStart[cell+1] - sys->cells->cellStart[cell])
+        growCells(sys);
+
     // 计算此原子为本空间第几个原子
-    int n = cell*MAXPERCELL;
+    int n = sys->cells->cellStart[cell];
     n = n + sys->cells->atomNum[cell];
    
     // 若不在通信区域中，本空间总原子数加1
@@ -132,105 +321,352 @@ void assignAtom(int id, double3 xyzpos, struct SystemStr* sys, double3 momenta){
     sys->cells->atomNum[cell]++;
 
     sys->atoms->id[n] = id;
+    sys->atoms->type[n] = type;
 
     // 对原子的位置坐标、动量赋值
     for(int i =0; i<3 ;i++){
         sys->atoms->pos[n][i] = xyzpos[i];
         sys->atoms->momenta[n][i] = momenta[i];
     }
+
+    return n;
 }
 
 // 初始化体系的温度，即原子的速度
+// 第一遍给定随机动量, 同时累加总动量及求动能所需的各项和; 第二遍一次完成总动量归零和温度校正
 void initTemperature(struct SystemStr* sys, struct ParameterStr* para){
 
     // 指定温度
     double temper = para->initTemper;
-    // 原子质量
-    double atomM = sys->lattice->atomM; 
- 
-    // 本空间所有原子总动量
-    double3 myMomenta = {0.0,0.0,0.0};
-
-    // 整个体系所有原子总动量
-    double3 globalMomenta = {0.0,0.0,0.0};
-
-    // 给定原子一个随机的速度及动量，并计算本空间的所有原子总动量
-    for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-        for (int n=MAXPERCELL*nCell, count=0; count<sys->cells->atomNum[nCell]; count++, n++)
+    // 各类型原子的质量
+    double* atomM = sys->lattice->atomM; 
+    double* invM = sys->lattice->invM;
+    Cell* cells = sys->cells;
+    Atom* atoms = sys->atoms;
+
+    // 各类型原子动量的标准差 m*sqrt(kB*T/m)
+    double scale[MAXTYPES];
+    for (int t = 0; t < sys->lattice->typeNum; t++)
+        scale[t] = sqrt(kB * temper * atomM[t]);
+
+    // 本空间的 总动量p(3), p/m之和(3), p^2/m之和, 1/m之和
+    double sum[8] = {0.0};
+
+    // 给定原子一个随机的动量, 随机数只由原子id决定
+    for (int nCell=0; nCell<cells->myCellNum; nCell++)
+        for (int n=cells->cellStart[nCell], count=0; count<cells->atomNum[nCell]; count++, n++)
         {
-            double sigma = sqrt(kB * temper/atomM);
-            uint64_t seed = mkSeed(sys->atoms->id[n], 123);
-            sys->atoms->momenta[n][0] = atomM * sigma * gasdev(&seed);
-            sys->atoms->momenta[n][1] = atomM * sigma * gasdev(&seed);
-            sys->atoms->momenta[n][2] = atomM * sigma * gasdev(&seed);
-
-            myMomenta[0] += sys->atoms->momenta[n][0];
-            myMomenta[1] += sys->atoms->momenta[n][1];
-            myMomenta[2] += sys->atoms->momenta[n][2];
+            int type = atoms->type[n];
+            double g[3];
+            gaussAt(atoms->id[n], 123, g);
+            for (int i=0; i<3; i++){
+                double p = scale[type] * g[i];
+                atoms->momenta[n][i] = p;
+                sum[i] += p;
+                sum[3+i] += p * invM[type];
+                sum[6] += p * p * invM[type];
+            }
+            sum[7] += invM[type];
         }
 
-    // 保证体系的总动量为0，在计算力之前需要调整为0
+    MPI_Allreduce(MPI_IN_PLACE, sum, 8, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-    // AllReduce, 得到整个体系的总动量
-    MPI_Allreduce(myMomenta, globalMomenta, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    
-    // 每个原子需要中和的动量值
+    // 每个原子需要中和的动量值, 使体系的总动量为0
     double3 adjustMomenta;
     for(int i=0; i<3; i++)
-        adjustMomenta[i] = -1 * globalMomenta[i]/sys->atoms->totalNum;
-
-    // 调整各原子动量
-    for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-        for (int n=MAXPERCELL*nCell, count=0; count<sys->cells->atomNum[nCell]; count++, n++)
-            for(int i=0 ;i<3 ;i++)
-                sys->atoms->momenta[n][i] += adjustMomenta[i];
-
-    // 调整总动量为0后，需要调整体系的温度为指定温度
-    computeTotalKinetic(sys);
-    // 调整前的系统温度
-    double t = (2*sys->energy->kineticEnergy)/(sys->atoms->totalNum*kB*3); 
-    // 校正因子
-    double factor = sqrt(temper/t);
-
-    // 调整温度,乘以校正因子
-    for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-        for (int n=MAXPERCELL*nCell, count=0; count<sys->cells->atomNum[nCell]; count++, n++)
-            for(int i=0 ;i<3 ;i++)
-                sys->atoms->momenta[n][i] *= factor; 
+        adjustMomenta[i] = -1 * sum[i]/sys->atoms->totalNum;
+
+    // 中和后的总动能: sum((p+a)^2/2m) = (sum(p^2/m) + 2a.sum(p/m) + a^2 sum(1/m))/2
+    double kinetic = sum[6];
+    for (int i=0; i<3; i++)
+        kinetic += 2.0*adjustMomenta[i]*sum[3+i] + adjustMomenta[i]*adjustMomenta[i]*sum[7];
+    kinetic *= 0.5;
+
+    // 调整前的系统温度及校正因子
+    double t = (2*kinetic)/(sys->atoms->totalNum*kB*3); 
+    double factor = t > 0.0 ? sqrt(temper/t) : 0.0;
+
+    // 调整各原子动量, 同时计算调整后的总动能
+    double myKineticEnergy = 0.0;
+    for (int nCell=0; nCell<cells->myCellNum; nCell++)
+        for (int n=cells->cellStart[nCell], count=0; count<cells->atomNum[nCell]; count++, n++)
+            for(int i=0 ;i<3 ;i++){
+                double p = (atoms->momenta[n][i] + adjustMomenta[i]) * factor;
+                atoms->momenta[n][i] = p;
+                myKineticEnergy += p * p * 0.5 * invM[atoms->type[n]];
+            }
 
-    // 计算调整后的总动能
-    computeTotalKinetic(sys);
+    sumTotalKinetic(sys->energy, myKineticEnergy);
     //printTemper(stdout, sys->energy, sys->atoms->totalNum);
 }
 
+// 计数排序所用的第二套原子数组, 重排后与当前数组交换
+static Atom spare;
+static int spareSlots = 0;
+
+// 以计数排序的方式重新分配本空间的所有原子: 先一次求出所有原子的新细胞,
+// 再按前缀和将原子依次写入第二套数组中, 最后交换两套数组
+// 调用前通信区域应已清空; 已记录的通信槽位随之失效, 在下次交换时重新记录
+static void sortAtoms(struct SystemStr* sys){
+
+    Cell* cells = sys->cells;
+    Atom* atoms = sys->atoms;
+    int myCellNum = cells->myCellNum;
+    int totalCellNum = cells->totalCellNum;
+
+    // 1. 本空间各原子所在的新细胞, 按原槽位存放
+    int ownedSlots = cells->cellStart[myCellNum];
+    int* dest = (int*)malloc((ownedSlots > 0 ? ownedSlots : 1)*sizeof(int));
+    for (int nCell=0; nCell<myCellNum; nCell++)
+        findCellsByCoord(cells, sys->space, atoms->pos + cells->cellStart[nCell],
+            cells->atomNum[nCell], dest + cells->cellStart[nCell]);
+
+    int* count = (int*)calloc(totalCellNum, sizeof(int));
+    for (int nCell=0; nCell<myCellNum; nCell++)
+        for (int n=cells->cellStart[nCell],k=0; k<cells->atomNum[nCell]; k++,n++)
+            count[dest[n]]++;
+
+    // 2. 各细胞的槽位数不够时扩容, 否则保持不变
+    int* oldStart = (int*)malloc((totalCellNum+1)*sizeof(int));
+    memcpy(oldStart, cells->cellStart, (totalCellNum+1)*sizeof(int));
+    int* capacity = (int*)malloc(totalCellNum*sizeof(int));
+    for (int i=0; i<totalCellNum; i++){
+        capacity[i] = oldStart[i+1] - oldStart[i];
+        if (count[i] > capacity[i])
+            capacity[i] = cellCapacity(count[i]);
+    }
+    layoutCells(cells, capacity);
+
+    if (spareSlots < cells->slotNum){
+        if (spareSlots > 0)
+            freeAtomArrays(&spare);
+        allocAtomArrays(&spare, cells->slotNum);
+        spareSlots = cells->slotNum;
+    }
+
+    // 3. 按原子的新细胞写入第二套数组
+    for (int i=0; i<totalCellNum; i++)
+        count[i] = 0;
+    for (int nCell=0; nCell<myCellNum; nCell++)
+        for (int n1=oldStart[nCell],k=0; k<cells->atomNum[nCell]; k++,n1++)
+        {
+            int cell = dest[n1];
+            int n2 = cells->cellStart[cell] + count[cell]++;
+            for (int i=0; i<3; i++){
+                spare.pos[n2][i] = atoms->pos[n1][i];
+                spare.momenta[n2][i] = atoms->momenta[n1][i];
+                spare.force[n2][i] = atoms->force[n1][i];
+            }
+            spare.pot[n2] = atoms->pot[n1];
+            spare.id[n2] = atoms->id[n1];
+            spare.type[n2] = atoms->type[n1];
+        }
+
+    atoms->myNum = 0;
+    for (int i=0; i<totalCellNum; i++){
+        cells->atomNum[i] = count[i];
+        if (i < myCellNum)
+            atoms->myNum += count[i];
+    }
+
+    // 4. 交换两套数组, 原子数等统计量保留在当前结构体中
+    // 原数组的长度至少为重排前的总槽位数
+    Atom current = *atoms;
+    *atoms = spare;
+    atoms->myNum = current.myNum;
+    atoms->totalNum = current.totalNum;
+    spare = current;
+    spareSlots = oldStart[totalCellNum];
+
+    free(dest);
+    free(count);
+    free(oldStart);
+    free(capacity);
+}
+
+// 交换两个槽位中的原子数据
+static void swapSlots(Atom* atoms, int a, int b){
+
+    for (int i=0; i<3; i++){
+        double t = atoms->pos[a][i]; atoms->pos[a][i] = atoms->pos[b][i]; atoms->pos[b][i] = t;
+        t = atoms->momenta[a][i]; atoms->momenta[a][i] = atoms->momenta[b][i]; atoms->momenta[b][i] = t;
+        t = atoms->force[a][i]; atoms->force[a][i] = atoms->force[b][i]; atoms->force[b][i] = t;
+    }
+    double p = atoms->pot[a]; atoms->pot[a] = atoms->pot[b]; atoms->pot[b] = p;
+    bigint id = atoms->id[a]; atoms->id[a] = atoms->id[b]; atoms->id[b] = id;
+    int k = atoms->type[a]; atoms->type[a] = atoms->type[b]; atoms->type[b] = k;
+}
+
+// 原子在细胞中所处的子格(各维度4等分)的Morton码
+static int subCellKey(double3 pos, double3 origin, double* cellLength){
+
+    int key = 0;
+    for (int i=0; i<3; i++){
+        int q = (int)(4.0*(pos[i] - origin[i])/cellLength[i]);
+        q = q < 0 ? 0 : (q > 3 ? 3 : q);
+        key |= ((q & 1) << i) | ((q >> 1) << (i+3));
+    }
+    return key;
+}
+
+// 将本空间各细胞内的原子按其所处子格的Morton码排序(插入排序, 细胞内原子数较少),
+// 使空间上相邻的原子在数组中也相邻; 须在原子交换前进行, 以免记录的通信槽位失效
+static void sortInCells(struct SystemStr* sys){
+
+    Cell* cells = sys->cells;
+    Atom* atoms = sys->atoms;
+
+    for (int nCell=0; nCell<cells->myCellNum; nCell++)
+    {
+        int num = cells->atomNum[nCell];
+        if (num < 2)
+            continue;
+
+        double3 origin;
+        getCellOrigin(cells, sys->space, nCell, origin);
+        int first = cells->cellStart[nCell];
+        int key[num];
+        for (int k=0; k<num; k++)
+            key[k] = subCellKey(atoms->pos[first+k], origin, cells->cellLength);
+
+        for (int k=1; k<num; k++)
+            for (int j=k; j>0 && key[j-1] > key[j]; j--){
+                int t = key[j]; key[j] = key[j-1]; key[j-1] = t;
+                swapSlots(atoms, first+j, first+j-1);
+            }
+    }
+}
+
 // 调整原子所在细胞，并进行原子数据通信(去掉了序号排序)
 void adjustAtoms(struct SystemStr* sys){
 
+    static int adjustCount = 0;
+    adjustCount++;
+    int sortCells = sys->sortInterval > 0 && adjustCount % sys->sortInterval == 0;
+
     // 清空本空间外的细胞
     for (int i=sys->cells->myCellNum; i<sys->cells->totalCellNum; i++)
         sys->cells->atomNum[i] = 0;
 
+    if (sys->sortRebin){
+        sortAtoms(sys);
+        if (sortCells)
+            sortInCells(sys);
+        exchangeAtoms(sys);
+        return;
+    }
+
     // 调整原子所在细胞
     for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-        for (int n = nCell*MAXPERCELL,count=0; count< sys->cells->atomNum[nCell];)
+        for (int count=0; count< sys->cells->atomNum[nCell];)
         {
+            // 移动原子时细胞可能扩容, 每次重新取细胞的起始槽位
+            int n = sys->cells->cellStart[nCell];
             int nCell2 = findCellByCoord(sys->cells, sys->space,sys->atoms->pos[n+count]);
             if (nCell2 == nCell){
                 count++;
                 continue;
             }   
-            moveAtom(sys->cells, sys->atoms, count, nCell, nCell2);           
+            moveAtom(sys, count, nCell, nCell2);           
+        }
+
+    if (sortCells)
+        sortInCells(sys);
+
+    exchangeAtoms(sys);
+}
+
+// 将dimen维度两侧迁移细胞中的原子写入发送缓冲区, 并从本进程删除
+static void putMigrateData(struct SystemStr* sys, int dimen, const int putSize[2]){
+
+    DataComm* comm = sys->datacomm;
+    char* putBuf = (char*)sys->usrBuf;
+    memcpy(putBuf, putSize, 2*sizeof(int));
+    addMigrateData(sys, putBuf+2*sizeof(int), 2*dimen);
+    addMigrateData(sys, putBuf+2*sizeof(int)+putSize[0]*sizeof(AtomData), 2*dimen+1);
+    for (int dir=2*dimen; dir<2*dimen+2; dir++)
+        for (int i=0; i<comm->migrateCellNum[dir]; i++)
+            sys->cells->atomNum[comm->migrateCells[dir][i]] = 0;
+}
+
+// 将dimen维度两侧通信细胞中的原子写入发送缓冲区
+static void putSendData(struct SystemStr* sys, int dimen, int negPutSize, int posPutSize){
+
+    char* putBuf = (char*)sys->usrBuf;
+    memcpy(putBuf, &negPutSize, sizeof(int));
+    memcpy(putBuf+sizeof(int), &posPutSize, sizeof(int));
+    addSendData(sys, putBuf+2*sizeof(int), 2*dimen);
+    addSendData(sys, putBuf+2*sizeof(int)+negPutSize*sizeof(AtomData), 2*dimen+1);
+}
+
+// 原子迁移: 按x, y, z的顺序将各方向外侧细胞中已移出本空间的原子发送给该方向的邻居进程, 发出后即从本进程删除
+// 新属主将其放入本空间细胞; 同时越过多个边界的原子落在接收方其他维度的外侧细胞中, 由后面的维度继续转发
+// 完成后本空间外只剩越过开放边界的原子, 与其他残留一同清空, 返回本进程清除的越过开放边界的原子数
+static int migrateAtoms(struct SystemStr* sys){
+
+    DataComm* comm = sys->datacomm;
+    Cell* cells = sys->cells;
+
+    beginTimer(communication);
+    for (int dimen=0; dimen<3; dimen++){
+
+        int neg_dimen = 2*dimen;
+        int pos_dimen = 2*dimen+1;
+
+        int putSize[2] = {0, 0};
+        for (int part=0; part<2; part++){
+            int dir = part == 0 ? neg_dimen : pos_dimen;
+            for (int i=0; i<comm->migrateCellNum[dir]; i++)
+                putSize[part] += cells->atomNum[comm->migrateCells[dir][i]];
+        }
+        // 窗口不足时先留下扩容请求, 同步后一同扩容再写入
+        int fits = reserveCommWindows(sys, 0, (putSize[0]+putSize[1])*sizeof(AtomData));
+        if (fits)
+            putMigrateData(sys, dimen, putSize);
+        MPI_Win_fence(0, sys->win2);
+        if (growCommWindows(sys)){
+            if (!fits)
+                putMigrateData(sys, dimen, putSize);
+            MPI_Win_fence(0, sys->win2);
         }
 
+        // 负方向邻居发送缓冲区中的正方向部分, 正方向邻居发送缓冲区中的负方向部分
+        int counts[2];
+        char* getBuf = neighborBuf(sys->win2, comm->neighborProc[neg_dimen]);
+        memcpy(counts, getBuf, 2*sizeof(int));
+        procRecvData(sys, getBuf+2*sizeof(int)+counts[0]*sizeof(AtomData), counts[1], pos_dimen);
+        getBuf = neighborBuf(sys->win2, comm->neighborProc[pos_dimen]);
+        memcpy(counts, getBuf, 2*sizeof(int));
+        procRecvData(sys, getBuf+2*sizeof(int), counts[0], neg_dimen);
+
+        MPI_Win_fence(0, sys->win2);
+    }
+    endTimer(communication);
+
+    int lost = 0;
+    for (int i=0; i<comm->lostCellNum; i++)
+        lost += cells->atomNum[comm->lostCells[i]];
+    for (int i=cells->myCellNum; i<cells->totalCellNum; i++)
+        cells->atomNum[i] = 0;
+    clearCommSlots(comm);
+    return lost;
+}
+
+// 与邻居进程交换原子数据: 先迁移已移出本空间的原子, 再由各进程的边界原子(含刚迁入的原子)重建通信区域
+void exchangeAtoms(struct SystemStr* sys){
+
+    // 清空上一次交换记录的槽位
+    clearCommSlots(sys->datacomm);
+    bigint lost = migrateAtoms(sys);
+
     //int haloatoms=0;
     //for (int i=sys->cells->myCellNum; i<sys->cells->totalCellNum; i++)
     //    haloatoms+=sys->cells->atomNum[i];
     //printf("haloatoms:%d\n",haloatoms);
-    MPI_Allreduce(&sys->atoms->myNum, &sys->atoms->totalNum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
     //printTotalAtom(stdout,sys->atoms);
     //printf("adjust\n");
 
-    dataToSmBuf(sys);
+    int smFits = dataToSmBuf(sys);
 
     // 与各邻居进程进行通信
     //enum Neighbor dimen;
@@ -241,13 +677,10 @@ void adjustAtoms(struct SystemStr* sys){
 
     // 内存共享，直接取数据，而不是点对点通信
     //int bufsize = sys->datacomm->bufSize;
-    char* PutBuf = (char *)sys->usrBuf;
     //char* negGetBuf = NULL;
     //char* posGetBuf = NULL;
    
-    MPI_Aint r1,r2;
     int recv1,recv2,recv1_t;
-    int t1,t2;
     char *getbuf1 = NULL;
     char *getbuf2= NULL;
 
@@ -278,6 +711,9 @@ void adjustAtoms(struct SystemStr* sys){
         for (int i=0; i<sys->datacomm->commCellNum[pos_dimen]; i++)
             posPutSize += sys->cells->atomNum[sys->datacomm->commCells[pos_dimen][i]];
         
+        // 发送缓冲区不足时先留下扩容请求, 同步后所有进程一同扩容, 再写入未能写入的数据
+        int fits = reserveCommWindows(sys, 0, (negPutSize+posPutSize)*sizeof(AtomData));
+
         //printf("%d: \n",PutSize*sizeof(AtomData));
         //beginTimer(test);
         // MPI_Win_allocate_shared(PutSize*sizeof(AtomData), sizeof(char),
@@ -287,17 +723,18 @@ void adjustAtoms(struct SystemStr* sys){
         ///应该拿到外面去，不能每次都开辟一个新窗口，从头到尾都用同一个
 
         // 将数据加入发送缓冲区
-        
-        //beginTimer(adjustatom);
-        memcpy(PutBuf,&negPutSize,sizeof(int));
-        memcpy(PutBuf+sizeof(int),&posPutSize,sizeof(int));
-
-        addSendData(sys, PutBuf+2*sizeof(int), neg_dimen);//应该先缓存然后一次性全部put???
-
-        addSendData(sys, PutBuf+2*sizeof(int)+negPutSize*sizeof(AtomData), pos_dimen);
-        //endTimer(adjustatom);
+        if (fits)
+            putSendData(sys, dimen, negPutSize, posPutSize);
         //printf("%d: \n",num );
        MPI_Win_fence(0,sys->win2);
+       if (growCommWindows(sys)){
+           if (!smFits)
+               smFits = dataToSmBuf(sys);
+           if (!fits)
+               putSendData(sys, dimen, negPutSize, posPutSize);
+           MPI_Win_fence(0,sys->win1);
+           MPI_Win_fence(0,sys->win2);
+       }
         //int pos_send = addSendData(sys, posSendBuf, dimen_POSI);
         //printf("addsend\n");
         // if (ifZeroRank())
@@ -309,15 +746,15 @@ void adjustAtoms(struct SystemStr* sys){
         //printf("1\n");
 
     
-       MPI_Win_shared_query(sys->win1,neg_neighbor, &r1, &t1, &smbuf1);
+       smbuf1 = neighborBuf(sys->win1, neg_neighbor);
        processSmData(sys, smbuf1, pos_dimen);
 
-       MPI_Win_shared_query(sys->win1,pos_neighbor, &r2, &t2, &smbuf2);
+       smbuf2 = neighborBuf(sys->win1, pos_neighbor);
        processSmData(sys, smbuf2, neg_dimen);
  
        MPI_Win_fence(0,sys->win1); 
 
-        MPI_Win_shared_query(sys->win2,neg_neighbor, &r1, &t1, &getbuf1);
+        getbuf1 = neighborBuf(sys->win2, neg_neighbor);
         
         //printf("%d \n",recv );
 
@@ -339,7 +776,7 @@ void adjustAtoms(struct SystemStr* sys){
         //else{
 
            // printf("start recv2 query\n");
-            MPI_Win_shared_query(sys->win2,pos_neighbor, &r2, &t2, &getbuf2);
+            getbuf2 = neighborBuf(sys->win2, pos_neighbor);
             //printf("recv2 query success  r2:%d\n",r2);
             memcpy((char *)&recv2,getbuf2,sizeof(int));
             //printf("recv2: %d\n",recv2 );
@@ -376,8 +813,8 @@ void adjustAtoms(struct SystemStr* sys){
         // if(dimen%2){
         //     printf("p %d:recv2:%d recv1:%d\n",getMyRank(),recv2,recv1 );
             
-             procRecvData(sys, getbuf1+2*sizeof(int)+recv1_t*sizeof(AtomData), recv1);
-             procRecvData(sys, getbuf2+2*sizeof(int), recv2);        
+             procRecvData(sys, getbuf1+2*sizeof(int)+recv1_t*sizeof(AtomData), recv1, pos_dimen);
+             procRecvData(sys, getbuf2+2*sizeof(int), recv2, neg_dimen);        
              //printf("p %d:procdata success\n",getMyRank());
         // }
              //free(posGetBuf);free(negGetBuf);
@@ -386,16 +823,38 @@ void adjustAtoms(struct SystemStr* sys){
     }
     endTimer(communication);
 
+    // 上次位置更新后本空间是否有原子越出收缩包裹边界, 这些原子留在最外层细胞中, 随后由expandBox外移边界
+    Spacial* space = sys->space;
+    int crossed = 0;
+    for (int d=0; d<3; d++)
+        if (space->shrinkWrap[d] && (sys->atomMin[d] < space->globalMin[d] || sys->atomMax[d] >= space->globalMax[d]))
+            crossed = 1;
+
+    // 迁移的原子均已被接收后再统计体系的总原子数、越过固定边界而丢弃的原子数及越出收缩包裹边界的进程数
+    updateActiveCells(sys->cells);
+    bigint counts[3] = {sys->atoms->myNum, lost, crossed};
+    MPI_Allreduce(MPI_IN_PLACE, counts, 3, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    sys->atoms->totalNum = counts[0];
+    sys->lostNum += counts[1];
+    sys->boxCrossed = counts[2] > 0;
+
     // 通信结束，释放缓冲区
     //free(posGetBuf);free(negGetBuf);
 }
 
 // 将cell1中的第N个原子移动到cell2中
-void moveAtom(struct CellStr* cells, Atom* atoms, int n, int cell1, int cell2){
+void moveAtom(struct SystemStr* sys, int n, int cell1, int cell2){
+
+    Cell* cells = sys->cells;
+
+    // 细胞cell2已满时扩容
+    if (cells->atomNum[cell2] == cells->cellStart[cell2+1] - cells->cellStart[cell2])
+        growCells(sys);
+    Atom* atoms = sys->atoms;
 
     // 先将原子数据写入细胞cell2中
-    int n1 = MAXPERCELL*cell1+n;
-    int n2 = MAXPERCELL*cell2+cells->atomNum[cell2];
+    int n1 = cells->cellStart[cell1]+n;
+    int n2 = cells->cellStart[cell2]+cells->atomNum[cell2];
     for(int i=0;i<3;i++){
         atoms->pos[n2][i]=atoms->pos[n1][i];
         atoms->momenta[n2][i]=atoms->momenta[n1][i];
@@ -403,6 +862,7 @@ void moveAtom(struct CellStr* cells, Atom* atoms, int n, int cell1, int cell2){
     }
     atoms->pot[n2] = atoms->pot[n1];
     atoms->id[n2] = atoms->id[n1];
+    atoms->type[n2] = atoms->type[n1];
 
     // cell2中原子总数加1
     cells->atomNum[cell2]++;
@@ -414,8 +874,8 @@ void moveAtom(struct CellStr* cells, Atom* atoms, int n, int cell1, int cell2){
     
     // 若cell1中还有原子，则将最后一个原子数据填补至被移动的原子处
     if (cells->atomNum[cell1]){
-        n1 = MAXPERCELL*cell1+cells->atomNum[cell1];
-        n2 = MAXPERCELL*cell1+n;
+        n1 = cells->cellStart[cell1]+cells->atomNum[cell1];
+        n2 = cells->cellStart[cell1]+n;
         for(int i=0;i<3;i++){
             atoms->pos[n2][i]=atoms->pos[n1][i];
             atoms->momenta[n2][i]=atoms->momenta[n1][i];
@@ -423,14 +883,24 @@ void moveAtom(struct CellStr* cells, Atom* atoms, int n, int cell1, int cell2){
         }
         atoms->pot[n2] = atoms->pot[n1];
         atoms->id[n2] = atoms->id[n1];
+        atoms->type[n2] = atoms->type[n1];
     }
 
     // 若原子移动出了本空间,则本空间总原子数减1
-    if (cell2 > cells->myCellNum) //此处不应该是>=??????
+    if (cell2 >= cells->myCellNum)
         atoms->myNum--;
 }
 
-void dataToSmBuf(struct SystemStr* sys){
+// 将共享细胞中的原子写入共享缓冲区, 缓冲区不足时只留下扩容请求并返回0
+static int dataToSmBuf(struct SystemStr* sys){
+
+    // 先统计写入的原子数, 检查共享缓冲区是否足够大
+    int total = 0;
+    for(int dimen=0;dimen<6;dimen++)
+        for (int nCell=0; nCell<sys->datacomm->sharedCellNum[dimen]; nCell++)
+            total += sys->cells->atomNum[sys->datacomm->sharedCells[dimen][nCell]];
+    if (!reserveCommWindows(sys, total*sizeof(AtomData), 0))
+        return 0;
 
     int atomnum=0;
 
@@ -449,23 +919,27 @@ void dataToSmBuf(struct SystemStr* sys){
             int cell = sharedCells[nCell];
             //getXYZByCell(sys->cells, xyz, cell);
             //int smCell = getSMCellByXYZ(sys->cells, xyz);
-             //int m = smCell * MAXPERCELL;
+             //int m = sys->cells->cellStart[smCell];
             //atomnum += sys->cells->atomNum[cell];
 
-            for (int n=cell*MAXPERCELL,count=0; count<sys->cells->atomNum[cell]; n++,count++)
+            for (int n=sys->cells->cellStart[cell],count=0; count<sys->cells->atomNum[cell]; n++,count++)
             {
                 for(int i=0;i<3;i++){
                     smbuf[atomnum].pos[i] = sys->atoms->pos[n][i];
                     smbuf[atomnum].momenta[i] = sys->atoms->momenta[n][i];
                 }
                 smbuf[atomnum].id  = sys->atoms->id[n];
+                smbuf[atomnum].type = sys->atoms->type[n];
+                pushSlot(&sys->datacomm->smSend, n);
                 atomnum++;
             }
         }
 
         memcpy(sys->smBuf+dimen*sizeof(int),&atomnum,sizeof(int));
+        sys->datacomm->smPartEnd[dimen] = atomnum;
 
     }
+    return 1;
 }
 
 void processSmData(struct SystemStr* sys, void *smbuf, enum Neighbor dimen){
@@ -485,7 +959,8 @@ void processSmData(struct SystemStr* sys, void *smbuf, enum Neighbor dimen){
 
     double3 pos; //原子坐标
     double3 momenta; //原子动量
-    int id;
+    bigint id;
+    int type;
 
     int* spacePos = sys->space->position;
     int* spaceNum = sys->space->globalProcNum;
@@ -516,13 +991,15 @@ void processSmData(struct SystemStr* sys, void *smbuf, enum Neighbor dimen){
             momenta[i] = buffer[num].momenta[i];
         }
         id = buffer[num].id;
+        type = buffer[num].type;
 
         //  if(getMyRank()==2){
         //     printf("num :%d \n",num );
         //     printf("pos: %g,%g,%g\n",pos[0],pos[1],pos[2] );
         //     printf("momenta: %g,%g,%g\n",momenta[0],momenta[1],momenta[2] );
         // }  
-        assignAtom(id, pos, sys, momenta);
+        int n = assignAtom(id, type, pos, sys, momenta);
+        pushSlot(&sys->datacomm->smRecv[dimen], n);
     }
      //printf("rank:%d test2\n ",getMyRank());
 }
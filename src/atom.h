@@ -4,8 +4,6 @@
 #ifndef ATOM_H_
 #define ATOM_H_
 
-// 每个细胞中的原子数最大值
-#define MAXPERCELL 64
 #define kB (8.6173324e-5) //波尔兹曼常数
 
 #include "mytype.h"
@@ -14,6 +12,7 @@
 struct CellStr;
 struct SystemStr;
 struct ParameterStr;
+struct atomDataStr;
 
 typedef struct AtomStr{
 
@@ -21,22 +20,30 @@ typedef struct AtomStr{
    	double3*  momenta;     // 原子动量
    	double3*  force;     // 原子受到的作用力 
    	double*  pot;     // 原子势能
+   	float*  relPos[3];  // 原子相对于所在细胞原点的单精度坐标,按xyz分量分开存储(混合精度模式)
 
 	int myNum; // 本进程空间中的总原子数
-	int totalNum; // 整个体系的总原子数
+	bigint totalNum; // 整个体系的总原子数
 
-	int* id;      // 各原子id
+	bigint* id;   // 各原子id, 作用力计算的循环中去重只比较槽位, 不读取id
+	int* type;    // 各原子类型, 即元素在晶格元素列表中的下标
 
 }Atom;
 
 // 初始化原子信息
 void initAtoms(struct CellStr* cells, Atom** ato);
 
+// 释放原子信息结构体
+void freeAtoms(Atom* atoms);
+
 // 分配各原子到对应的细胞中
 void distributeAtoms(struct SystemStr* sys, struct ParameterStr* para);
 
-// 将指定原子根据其坐标，分配到对应的细胞中
-void assignAtom(int id, double3 xyzpos, struct SystemStr* sys, double3 momenta);
+// 将一组原子放入各细胞中, 按各细胞的原子数重新划分槽位(计数排序)
+void placeAtoms(struct SystemStr* sys, struct atomDataStr* list, int num);
+
+// 将指定原子根据其坐标，分配到对应的细胞中, 返回原子所在的槽位, 细胞已满时自动扩容
+int assignAtom(bigint id, int type, double3 xyzpos, struct SystemStr* sys, double3 momenta);
 
 // 初始化体系的温度，即原子的速度
 void initTemperature(struct SystemStr* sys, struct ParameterStr* para);
@@ -44,7 +51,11 @@ void initTemperature(struct SystemStr* sys, struct ParameterStr* para);
 // 调整原子所在细胞，并进行原子数据通信
 void adjustAtoms(struct SystemStr* sys);
 
-// 将cell1中的第N个原子移动到cell2中
-void moveAtom(struct CellStr* cells, Atom* atoms, int n, int cell1, int cell2);
+// 与邻居进程交换原子数据: 发送通信区域中已移出本空间的原子, 并接收邻居的边界原子
+// 调用前通信区域中应只有移出本空间的原子
+void exchangeAtoms(struct SystemStr* sys);
+
+// 将cell1中的第N个原子移动到cell2中, cell2已满时自动扩容
+void moveAtom(struct SystemStr* sys, int n, int cell1, int cell2);
 
 #endif
\ No newline at end of file
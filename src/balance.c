@@ -0,0 +1,227 @@
+#include "balance.h"
+#include "system.h"
+#include "timer.h"
+#include "info.h"
+#include "mympi.h"
+#include "cell.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <mpi.h>
+
+// 上次调整时计算作用力的累计时间
+static double lastForceTime = 0.0;
+
+// 由各层的负载求新的分界面
+// 假设每层内的负载沿该轴均匀分布, 将分界面移至使各层负载相等的位置;
+// 每次只移动一部分, 且不超过maxShift, 各层长度不小于minLength
+static void movePlanes(double* planes, int procNum, const double* load, double maxShift, double minLength){
+
+	double total = 0.0;
+	for (int k = 0; k < procNum; k++)
+		total += load[k];
+	if (total <= 0.0)
+		return;
+
+	double* newPlanes = (double*)malloc((procNum+1)*sizeof(double));
+	newPlanes[0] = planes[0];
+	newPlanes[procNum] = planes[procNum];
+
+	// 累计负载为分段线性函数, 求其取值为 total*k/procNum 处的坐标
+	int j = 0;
+	double sum = 0.0;
+	for (int k = 1; k < procNum; k++){
+
+		double target = total*k/procNum;
+		while (j < procNum-1 && sum + load[j] < target){
+			sum += load[j];
+			j++;
+		}
+		double frac = load[j] > 0.0 ? (target - sum)/load[j] : 0.5;
+		if (frac < 0.0) frac = 0.0;
+		if (frac > 1.0) frac = 1.0;
+		double p = planes[j] + frac*(planes[j+1] - planes[j]);
+		p = planes[k] + BALANCE_DAMPING*(p - planes[k]);
+
+		if (p > planes[k] + maxShift) p = planes[k] + maxShift;
+		if (p < planes[k] - maxShift) p = planes[k] - maxShift;
+		newPlanes[k] = p;
+	}
+
+	// 若有层的长度小于最小长度, 按比例缩小所有分界面的移动量
+	double alpha = 1.0;
+	for (int k = 0; k < procNum; k++){
+		double oldLength = planes[k+1] - planes[k];
+		double newLength = newPlanes[k+1] - newPlanes[k];
+		if (newLength < minLength && newLength < oldLength){
+			double a = (oldLength - minLength)/(oldLength - newLength);
+			if (a < alpha)
+				alpha = a;
+		}
+	}
+	if (alpha < 0.0)
+		alpha = 0.0;
+
+	for (int k = 1; k < procNum; k++)
+		planes[k] += alpha*(newPlanes[k] - planes[k]);
+
+	free(newPlanes);
+}
+
+// 原子数不均衡度: 各进程原子数的最大值与平均值之比
+static double atomImbalance(System* sys){
+
+	// 总原子数在每次原子交换后已统计
+	int maxNum;
+	MPI_Allreduce(&sys->atoms->myNum, &maxNum, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	bigint sumNum = sys->atoms->totalNum;
+	return sumNum > 0 ? (double)maxNum*getRankNums()/sumNum : 1.0;
+}
+
+// 按新的空间范围重建细胞、原子及通信结构, 并将原子分配至新的细胞中
+// 分界面移动不超过一个细胞长度, 移出本空间的原子均落在通信区域中, 由exchangeAtoms发送给邻居进程
+static void rebuildDomain(System* sys){
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+	// 暂存本空间的原子
+	int num = 0;
+	for (int nCell=0; nCell<cells->myCellNum; nCell++)
+		num += cells->atomNum[nCell];
+	AtomData* saved = (AtomData*)malloc((num > 0 ? num : 1)*sizeof(AtomData));
+	num = 0;
+	for (int nCell=0; nCell<cells->myCellNum; nCell++)
+		for (int n=cells->cellStart[nCell],count=0; count<cells->atomNum[nCell]; count++,n++)
+		{
+			saved[num].id = atoms->id[n];
+			saved[num].type = atoms->type[n];
+			for (int i=0; i<3; i++){
+				saved[num].pos[i] = atoms->pos[n][i];
+				saved[num].momenta[i] = atoms->momenta[n][i];
+			}
+			num++;
+		}
+
+	int cellDivision = sys->cells->haloDepth;
+	int mortonOrder = sys->cells->mortonOrder;
+	freeCommWindows(sys);
+	freeComm(sys->datacomm);
+	freeAtoms(sys->atoms);
+	freeCells(sys->cells);
+
+	initCells(sys->space, sys->potential, cellDivision, mortonOrder, &sys->cells);
+	initAtoms(sys->cells, &sys->atoms);
+	initComm(&sys->datacomm, sys->space, sys->cells);
+	allocCommWindows(sys);
+
+	placeAtoms(sys, saved, num);
+	free(saved);
+	tileCells(sys->cells, sys->tileSize, (double)sys->atoms->myNum/sys->cells->myCellNum);
+
+	// 迁移移出本空间的原子并重建通信区域
+	exchangeAtoms(sys);
+}
+
+// 调整空间划分并重建细胞、通信区域及原子数据, 同时完成本步的原子迁移和通信
+// 分界面在各维度上为同一层进程所共用(直线网格), 使每个进程在各方向上仍只有一个邻居
+void balanceSpace(struct SystemStr* sys){
+
+	Spacial* space = sys->space;
+
+	// 体系边界外移时已重建空间划分, 本次不再调整
+	if (expandBox(sys))
+		return;
+
+	// 本进程自上次调整以来计算作用力的时间作为负载
+	double forceTime = getGlobalTime(force);
+	double load = forceTime - lastForceTime;
+	lastForceTime = forceTime;
+
+	double maxLoad, sumLoad;
+	MPI_Allreduce(&load, &maxLoad, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+	MPI_Allreduce(&load, &sumLoad, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	double timeImbalance = sumLoad > 0.0 ? maxLoad*getRankNums()/sumLoad : 1.0;
+	double atomBefore = atomImbalance(sys);
+
+	if (timeImbalance < BALANCE_TOLERANCE){
+		adjustAtoms(sys);
+		printBalance(stdout, timeImbalance, atomBefore, atomBefore);
+		return;
+	}
+
+	double minLength = MINCELLS*sys->potential->cutoff*(1.0 + 1e-9);
+	for (int d = 0; d < 3; d++){
+
+		int procNum = space->globalProcNum[d];
+		if (procNum == 1)
+			continue;
+
+		// 各层的负载为该层所有进程负载之和
+		double* slabLoad = (double*)calloc(procNum, sizeof(double));
+		slabLoad[space->position[d]] = load;
+		MPI_Allreduce(MPI_IN_PLACE, slabLoad, procNum, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+		// 分界面每次移动不超过最薄的通信区域厚度
+		double haloLength = sys->cells->cellLength[d]*sys->cells->haloDepth;
+		double maxShift;
+		MPI_Allreduce(&haloLength, &maxShift, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+
+		movePlanes(space->planes[d], procNum, slabLoad, maxShift, minLength);
+		free(slabLoad);
+	}
+
+	updateSpaceBounds(space);
+	rebuildDomain(sys);
+
+	printBalance(stdout, timeImbalance, atomBefore, atomImbalance(sys));
+}
+
+// 收缩包裹边界上有原子越出体系时, 将该侧的体系边界外移并重建空间划分, 同时完成本步的原子迁移和通信
+// 越出的原子在外移之前留在属主进程的最外层细胞中; 只在上次原子交换发现有原子越出时才进行集合通信,
+// 范围取自本步位置更新时记录的原子坐标
+int expandBox(struct SystemStr* sys){
+
+	Spacial* space = sys->space;
+	if (! sys->boxCrossed)
+		return 0;
+
+	// 各维度原子坐标的最小值及最大值的相反数
+	double extent[6];
+	for (int d = 0; d < 3; d++){
+		extent[2*d] = sys->atomMin[d];
+		extent[2*d+1] = -sys->atomMax[d];
+	}
+	MPI_Allreduce(MPI_IN_PLACE, extent, 6, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+
+	// 越出的一侧外移至原子之外一个截断距离处, 避免边界随原子逐步移动而频繁重建
+	double margin = sys->potential->cutoff;
+	int expand = 0;
+	for (int d = 0; d < 3; d++){
+
+		if (! space->shrinkWrap[d])
+			continue;
+
+		int procNum = space->globalProcNum[d];
+		if (extent[2*d] < space->globalMin[d]){
+			space->planes[d][0] = extent[2*d] - margin;
+			expand = 1;
+		}
+		if (-extent[2*d+1] >= space->globalMax[d]){
+			space->planes[d][procNum] = -extent[2*d+1] + margin;
+			expand = 1;
+		}
+		space->globalMin[d] = space->planes[d][0];
+		space->globalMax[d] = space->planes[d][procNum];
+		space->globalLength[d] = space->globalMax[d] - space->globalMin[d];
+	}
+	if (! expand)
+		return 0;
+
+	updateSpaceBounds(space);
+	rebuildDomain(sys);
+
+	printBoxExpand(stdout, space);
+	return 1;
+}
@@ -0,0 +1,22 @@
+// balance.h
+// 动态负载均衡: 根据各进程计算作用力的时间移动各空间的分界面
+
+#ifndef BALANCE_H_
+#define BALANCE_H_
+
+// 作用力时间的不均衡度低于此值时不调整, 避免因计时的波动反复移动分界面
+#define BALANCE_TOLERANCE 1.05
+
+// 分界面每次只移动到目标位置的这一比例处, 抑制负载测量误差引起的振荡
+#define BALANCE_DAMPING 0.5
+
+struct SystemStr;
+
+// 调整空间划分并重建细胞、通信区域及原子数据, 同时完成本步的原子迁移和通信, 代替本步的adjustAtoms
+void balanceSpace(struct SystemStr* sys);
+
+// 收缩包裹边界上有原子越出体系时, 将该侧的体系边界外移并重建空间划分, 同时完成本步的原子迁移和通信
+// 只在上次原子交换发现有原子越出时进行集合通信; 返回1表示已重建(代替本步的adjustAtoms), 0表示无需外移
+int expandBox(struct SystemStr* sys);
+
+#endif
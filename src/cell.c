@@ -3,54 +3,311 @@
 #include "space.h"
 #include "potential.h"
 #include "mympi.h"
+#include "error.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// 将xyz坐标的各二进制位交错排列得到Morton码
+uint64_t mortonKey(int x, int y, int z){
+
+	uint64_t key = 0;
+	for (int b = 0; b < 21; b++)
+		key |= ((uint64_t)((x>>b)&1) << (3*b)) | ((uint64_t)((y>>b)&1) << (3*b+1))
+			| ((uint64_t)((z>>b)&1) << (3*b+2));
+	return key;
+}
+
+typedef struct MortonCellStr{
+
+	uint64_t key;
+	int index;   // 按x,y,z顺序排列时的序号
+
+}MortonCell;
+
+static int compareMorton(const void* a, const void* b){
+
+	uint64_t ka = ((const MortonCell*)a)->key;
+	uint64_t kb = ((const MortonCell*)b)->key;
+	return (ka > kb) - (ka < kb);
+}
+
+// 本空间各细胞的序号, 下标为其按x,y,z顺序排列时的序号
+// mortonOrder为1时按Morton码排序, 使空间上相邻的细胞在数组中也大多相邻
+static int* ownedCellOrder(Cell* cells){
+
+	int* n = cells->xyzCellNum;
+	int* order = (int*)malloc(cells->myCellNum*sizeof(int));
+
+	if (! cells->mortonOrder){
+		for (int i = 0; i < cells->myCellNum; i++)
+			order[i] = i;
+		return order;
+	}
+
+	MortonCell* list = (MortonCell*)malloc(cells->myCellNum*sizeof(MortonCell));
+	for (int z = 0, i = 0; z < n[2]; z++)
+		for (int y = 0; y < n[1]; y++)
+			for (int x = 0; x < n[0]; x++, i++){
+				list[i].key = mortonKey(x, y, z);
+				list[i].index = i;
+			}
+	qsort(list, cells->myCellNum, sizeof(MortonCell), compareMorton);
+	for (int i = 0; i < cells->myCellNum; i++)
+		order[list[i].index] = i;
+	free(list);
+	return order;
+}
+
+// 建立扩展区域(本空间及外侧haloDepth层通信细胞)中的位置与细胞序号的对应表
+// 本空间的细胞在前, 按x,y,z顺序或Morton顺序排列; 通信区域的细胞在后, 按其在扩展区域中的顺序排列
+static void buildCellTables(Cell* cells){
+
+	int H = cells->haloDepth;
+	int* n = cells->xyzCellNum;
+	int* p = cells->padCellNum;
+	int* order = ownedCellOrder(cells);
+
+	cells->padToCell = (int*)malloc(p[0]*p[1]*p[2]*sizeof(int));
+	cells->cellToPad = (int*)malloc(cells->totalCellNum*sizeof(int));
+
+	int halo = cells->myCellNum;
+	int pad = 0;
+	int3 xyz;
+	for (xyz[2] = -H; xyz[2] < n[2]+H; xyz[2]++)
+		for (xyz[1] = -H; xyz[1] < n[1]+H; xyz[1]++)
+			for (xyz[0] = -H; xyz[0] < n[0]+H; xyz[0]++, pad++)
+			{
+				int cell;
+				if (xyz[0] >= 0 && xyz[0] < n[0] && xyz[1] >= 0 && xyz[1] < n[1] &&
+					xyz[2] >= 0 && xyz[2] < n[2])
+					cell = order[xyz[0] + n[0]*(xyz[1] + n[1]*xyz[2])];
+				else
+					cell = halo++;
+				cells->padToCell[pad] = cell;
+				cells->cellToPad[cell] = pad;
+			}
+	free(order);
+}
+
+// 找出与半径为cutoff的截断球相交的邻居细胞: 两细胞间的最短距离小于截断距离
+// 偏移按x,y,z从外到内的顺序排列, 且关于本细胞对称, 返回邻居细胞数
+static int buildStencil(Cell* cells, double cutoff, int** list){
+
+	int H = cells->haloDepth;
+	int* p = cells->padCellNum;
+	int width = 2*H + 1;
+
+	int* stencil = (int*)malloc(width*width*width*sizeof(int));
+	int num = 0;
+
+	int3 d;
+	for (d[0] = -H; d[0] <= H; d[0]++)
+		for (d[1] = -H; d[1] <= H; d[1]++)
+			for (d[2] = -H; d[2] <= H; d[2]++)
+			{
+				double dist2 = 0.0;
+				for (int i = 0; i < 3; i++)
+				{
+					int gap = abs(d[i]) - 1;
+					if (gap > 0)
+						dist2 += (gap*cells->cellLength[i])*(gap*cells->cellLength[i]);
+				}
+				if (dist2 >= cutoff*cutoff)
+					continue;
+				stencil[num++] = d[0] + p[0]*(d[1] + p[1]*d[2]);
+			}
+	*list = stencil;
+	return num;
+}
 
 // 初始化细胞链表
-void initCells(struct SpacialStr* space, struct PotentialStr* potential, struct CellStr** cel){
+void initCells(struct SpacialStr* space, struct PotentialStr* potential, int cellDivision, int mortonOrder,
+	struct CellStr** cel){
 
 	*cel = (Cell*)malloc(sizeof(Cell));
   Cell* cells = *cel;
 
-	// 保证细胞长度大于等于截断距离
+	if (cellDivision < 1){
+		errorInfo(cellDiv);
+		exit(cellDiv);
+	}
+
+	// 保证细胞长度大于等于截断距离的1/cellDivision, 则haloDepth层细胞的厚度不小于截断距离
+	cells->haloDepth = cellDivision;
+	cells->mortonOrder = mortonOrder;
 	for (int i = 0; i < 3; i++)
    	{
-      	cells->xyzCellNum[i] = space->myLength[i] / potential->cutoff; 
+      	cells->xyzCellNum[i] = space->myLength[i] / (potential->cutoff/cellDivision); 
       	cells->cellLength[i] = space->myLength[i] / ((double) cells->xyzCellNum[i]);
+      	cells->padCellNum[i] = cells->xyzCellNum[i] + 2*cellDivision;
+
+      	// 越出收缩包裹边界的原子仍由本进程计算, 在体系边界外移之前留在最外层细胞中
+      	int lowFace = space->shrinkWrap[i] && space->position[i] == 0;
+      	int highFace = space->shrinkWrap[i] && space->position[i] == space->globalProcNum[i]-1;
+      	cells->cellMin[i] = lowFace ? 0 : -cellDivision;
+      	cells->cellMax[i] = highFace ? cells->xyzCellNum[i]-1 : cells->xyzCellNum[i]+cellDivision-1;
    	}
 
    	// 实际细胞数为 x * y * z
    	cells->myCellNum = cells->xyzCellNum[0] * cells->xyzCellNum[1] * cells->xyzCellNum[2];
    
    	// 通信细胞数
-   	cells->commCellNum = 2 * ((cells->xyzCellNum[0] + 2) *
-                         (cells->xyzCellNum[1] + cells->xyzCellNum[2] + 2) +
-                         (cells->xyzCellNum[1] * cells->xyzCellNum[2]));
+   	cells->commCellNum = cells->padCellNum[0]*cells->padCellNum[1]*cells->padCellNum[2] - cells->myCellNum;
 
    	// 总细胞数
    	cells->totalCellNum = cells->myCellNum + cells->commCellNum;
    
    	cells->atomNum = malloc(cells->totalCellNum*sizeof(int));
+   	cells->cellStart = malloc((cells->totalCellNum+1)*sizeof(int));
 
-   	// 初始化各细胞中原子数为0
-   	for (int i = 0; i < cells->totalCellNum; i++)
+   	// 初始化各细胞中原子数为0, 槽位数为最小余量, 放入原子时再按实际原子数重新划分(真空区域不占槽位)
+   	int* capacity = malloc(cells->totalCellNum*sizeof(int));
+   	for (int i = 0; i < cells->totalCellNum; i++){
       	cells->atomNum[i] = 0;
+      	capacity[i] = cellCapacity(0);
+   	}
+   	layoutCells(cells, capacity);
+   	free(capacity);
+
+   	cells->activeNum = 0;
+   	cells->active = malloc(cells->myCellNum*sizeof(int));
+
+   	buildCellTables(cells);
+   	cells->stencilNum = buildStencil(cells, potential->cutoff, &cells->stencil);
+   	cells->innerStencilNum = buildStencil(cells,
+   		potential->respaSteps > 1 ? potential->respaCutoff : potential->cutoff, &cells->innerStencil);
+
+   	// 默认整个空间为一个分块
+   	cells->sweep = malloc(cells->myCellNum*sizeof(int));
+   	for (int i = 0; i < cells->myCellNum; i++)
+   		cells->sweep[i] = i;
+   	for (int i = 0; i < 3; i++)
+   		cells->tileCellNum[i] = cells->xyzCellNum[i];
+}
+
+// 读取L2缓存大小(字节)
+static long l2CacheSize(){
+
+	long size = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+	if (size <= 0){
+		FILE* f = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+		if (f){
+			char unit = 0;
+			if (fscanf(f, "%ld%c", &size, &unit) >= 1 && (unit == 'K' || unit == 'k'))
+				size *= 1024;
+			else if (unit == 'M' || unit == 'm')
+				size *= 1024*1024;
+			fclose(f);
+		}
+	}
+	return size > 0 ? size : DEFAULTL2CACHE;
+}
+
+// 按分块重新安排遍历本空间细胞的顺序
+// 自动选择时取立方体分块, 分块连同其外侧haloDepth层邻居细胞的数据不超过L2缓存的一半
+void tileCells(Cell* cells, int tileSize, double atomsPerCell){
+
+	int H = cells->haloDepth;
+	int* n = cells->xyzCellNum;
+
+	if (tileSize <= 0){
+		double cellBytes = (atomsPerCell > 1.0 ? atomsPerCell : 1.0)*TILEBYTESPERATOM;
+		double budget = 0.5*l2CacheSize();
+		tileSize = 1;
+		while ((tileSize+1+2*H)*(tileSize+1+2*H)*(double)(tileSize+1+2*H)*cellBytes <= budget)
+			tileSize++;
+	}
+
+	for (int i = 0; i < 3; i++)
+		cells->tileCellNum[i] = tileSize < n[i] ? tileSize : n[i];
+	int* t = cells->tileCellNum;
+
+	int k = 0;
+	int3 xyz;
+	for (int tz = 0; tz < n[2]; tz += t[2])
+		for (int ty = 0; ty < n[1]; ty += t[1])
+			for (int tx = 0; tx < n[0]; tx += t[0])
+				for (xyz[2] = tz; xyz[2] < tz+t[2] && xyz[2] < n[2]; xyz[2]++)
+					for (xyz[1] = ty; xyz[1] < ty+t[1] && xyz[1] < n[1]; xyz[1]++)
+						for (xyz[0] = tx; xyz[0] < tx+t[0] && xyz[0] < n[0]; xyz[0]++)
+							cells->sweep[k++] = findCellByXYZ(cells, xyz);
+	updateActiveCells(cells);
+}
+
+// 按sweep的顺序重新统计本空间中有原子的细胞
+void updateActiveCells(Cell* cells){
+
+	int num = 0;
+	for (int k = 0; k < cells->myCellNum; k++)
+		if (cells->atomNum[cells->sweep[k]] > 0)
+			cells->active[num++] = cells->sweep[k];
+	cells->activeNum = num;
+}
 
-    ///test 测试cell坐标正确性
-    // if(getMyRank()== 5){
-    //     int3 xyz;
-    //     int j,k;
-    //     for(int i = 0; i < cells->totalCellNum; i++)
-    //     {
-    //         getXYZByCell(cells,xyz, i);
-    //         printf("i: %d xyz:%d %d %d\n",i,xyz[0],xyz[1],xyz[2]);
-    //         j = findCellByXYZ(cells, xyz);
-    //         k = getSMCellByXYZ(cells, xyz);
-    //         printf("j: %d k: %d xyz:%d %d %d\n\n",j,k,xyz[0],xyz[1],xyz[2]);
-    //     }
-    // }
+// 释放细胞链表
+void freeCells(Cell* cells){
+
+    if (cells){
+        free(cells->atomNum);
+        free(cells->cellStart);
+        free(cells->padToCell);
+        free(cells->cellToPad);
+        free(cells->stencil);
+        free(cells->innerStencil);
+        free(cells->sweep);
+        free(cells->active);
+        free(cells);
+    }
+}
+
+// 原子数为count的细胞应分配的槽位数
+int cellCapacity(int count){
+
+    return count + count/4 + CELLSLACK;
+}
+
+// 由各细胞(包括通信区域)的原子数求各细胞的槽位数: 空细胞只有在相邻细胞中有原子时才保留最小余量
+void cellCapacities(Cell* cells, const int* count, int* capacity){
+
+    int* p = cells->padCellNum;
+
+    for (int c = 0; c < cells->totalCellNum; c++)
+    {
+        if (count[c] > 0){
+            capacity[c] = cellCapacity(count[c]);
+            continue;
+        }
+
+        int pad = cells->cellToPad[c];
+        int3 q = {pad % p[0], (pad / p[0]) % p[1], pad / (p[0]*p[1])};
+        int occupied = 0;
+        for (int dz = -1; dz <= 1 && ! occupied; dz++)
+            for (int dy = -1; dy <= 1 && ! occupied; dy++)
+                for (int dx = -1; dx <= 1 && ! occupied; dx++)
+                {
+                    int3 r = {q[0]+dx, q[1]+dy, q[2]+dz};
+                    if (r[0] < 0 || r[0] >= p[0] || r[1] < 0 || r[1] >= p[1] || r[2] < 0 || r[2] >= p[2])
+                        continue;
+                    occupied = count[cells->padToCell[r[0] + p[0]*(r[1] + p[1]*r[2])]] > 0;
+                }
+        capacity[c] = occupied ? cellCapacity(0) : 0;
+    }
+}
+
+// 按各细胞的槽位数重新计算各细胞的起始槽位(前缀和)
+void layoutCells(Cell* cells, int* capacity){
+
+    cells->cellStart[0] = 0;
+    for (int i = 0; i < cells->totalCellNum; i++)
+        cells->cellStart[i+1] = cells->cellStart[i] + capacity[i];
+    cells->slotNum = cells->cellStart[cells->totalCellNum];
 }
 
 // 根据原子坐标找到所在的细胞
@@ -68,171 +325,119 @@ int findCellByCoord(Cell* cells, Spacial* space, double3 coord){
     cellPos[2] = (int)(floor((coord[2] - myMin[2])/cells->cellLength[2]));
 
     // 如果原子坐标超出了空间边界，则加入至通信区域的细胞中
+    // 邻居进程的细胞可能比本进程的长, 其边界细胞中的原子可能超出本进程通信区域的范围, 归入最外层细胞
+    // 越出收缩包裹边界的原子归入本空间的最外层细胞
     for(int i = 0; i< 3 ; i++){
-        if(coord[i] >= myMax[i])
+        if(coord[i] >= myMax[i] && cellPos[i] < xyzCellNum[i])
             cellPos[i] = xyzCellNum[i];
+        if(cellPos[i] > cells->cellMax[i])
+            cellPos[i] = cells->cellMax[i];
+        if(cellPos[i] < cells->cellMin[i])
+            cellPos[i] = cells->cellMin[i];
     }
 
     return findCellByXYZ(cells, cellPos);
 }
 
+// 批量求num个原子所在的细胞序号, 规则与findCellByCoord相同
+// 循环体内没有函数调用, 边界处理用取大取小代替分支, 便于编译器向量化
+void findCellsByCoord(Cell* cells, Spacial* space, double3* coord, int num, int* cell){
+
+    int H = cells->haloDepth;
+    int* n = cells->xyzCellNum;
+    int* p = cells->padCellNum;
+    double* myMin = space->myMin;
+    double* myMax = space->myMax;
+    double* cellLength = cells->cellLength;
+    int* padToCell = cells->padToCell;
+    int* cellMin = cells->cellMin;
+    int* cellMax = cells->cellMax;
+
+    for (int k = 0; k < num; k++)
+    {
+        int pad[3];
+        for (int i = 0; i < 3; i++)
+        {
+            int c = (int)floor((coord[k][i] - myMin[i])/cellLength[i]);
+            int outside = coord[k][i] >= myMax[i];
+            c = (outside && c < n[i]) ? n[i] : c;
+            c = c > cellMax[i] ? cellMax[i] : c;
+            c = c < cellMin[i] ? cellMin[i] : c;
+            pad[i] = c + H;
+        }
+        cell[k] = padToCell[pad[0] + p[0]*(pad[1] + p[1]*pad[2])];
+    }
+}
+
 // 根据细胞位置xyz返回细胞序号，即该空间中第几个细胞
 int findCellByXYZ(Cell* cells, int* xyz){
 
-    int cell;
-
-    int myCellNum = cells->myCellNum;
-    int *xyzCellNum = cells->xyzCellNum;
-
-    // Z轴正方向的通信区域细胞
-    if (xyz[2] == xyzCellNum[2])
-        cell = myCellNum + 2*xyzCellNum[2]*xyzCellNum[1] + 2*xyzCellNum[2]*(xyzCellNum[0]+2) +
-            (xyzCellNum[0]+2)*(xyzCellNum[1]+2) + (xyzCellNum[0]+2)*(xyz[1]+1) + (xyz[0]+1);
-    // Z轴负方向的通信区域细胞
-    else if (xyz[2] == -1)
-        cell = myCellNum + 2*xyzCellNum[2]*xyzCellNum[1] + 2*xyzCellNum[2]*(xyzCellNum[0]+2) +
-            (xyzCellNum[0]+2)*(xyz[1]+1) + (xyz[0]+1);
-    // Y轴正方向的通信区域细胞
-    else if (xyz[1] == xyzCellNum[1])
-        cell = myCellNum + 2*xyzCellNum[2]*xyzCellNum[1] + xyzCellNum[2]*(xyzCellNum[0]+2) +
-            (xyzCellNum[0]+2)*xyz[2] + (xyz[0]+1);
-   // Y轴负方向的通信区域细胞
-    else if (xyz[1] == -1)
-        cell = myCellNum + 2*xyzCellNum[2]*xyzCellNum[1] + xyz[2]*(xyzCellNum[0]+2) + (xyz[0]+1);
-   // X轴正方向的通信区域细胞
-    else if (xyz[0] == xyzCellNum[0])
-        cell = myCellNum + xyzCellNum[1]*xyzCellNum[2] + xyz[2]*xyzCellNum[1] + xyz[1];
-   // X轴负方向的通信区域细胞
-    else if (xyz[0] == -1)
-        cell = myCellNum + xyz[2]*xyzCellNum[1] + xyz[1];
-   // 本空间中实际的细胞
-    else
-        cell = xyz[0] + xyzCellNum[0]*xyz[1] + xyzCellNum[0]*xyzCellNum[1]*xyz[2];
-
-    return cell;
+    int H = cells->haloDepth;
+    int* p = cells->padCellNum;
+
+    return cells->padToCell[(xyz[0]+H) + p[0]*((xyz[1]+H) + p[1]*(xyz[2]+H))];
 }
 
 // 根据细胞序号返回细胞位置xyz,与函数findCellByXYZ互为逆过程
 void getXYZByCell(Cell* cells,int *xyz, int num){
 
-    int *xyzCellNum = cells->xyzCellNum;
-   
-    if( num < cells->myCellNum)
-    {
-        xyz[0] = num % xyzCellNum[0];
-        num /= xyzCellNum[0];
-        xyz[1] = num % xyzCellNum[1];
-        xyz[2] = num / xyzCellNum[1];
-    }
-    else 
-    {
-        int ink;
-        ink = num - cells->myCellNum;
-        if (ink < 2*xyzCellNum[1]*xyzCellNum[2])
-        {
-            if (ink < xyzCellNum[1]*xyzCellNum[2]) 
-            {
-                xyz[0] = 0;
-            }
-            else 
-            {
-                ink -= xyzCellNum[1]*xyzCellNum[2];
-                xyz[0] = xyzCellNum[0] + 1;
-            }
-            xyz[1] = 1 + ink % xyzCellNum[1];
-            xyz[2] = 1 + ink / xyzCellNum[1];
-        }
-        else if (ink < (2 * xyzCellNum[2] * (xyzCellNum[1] + xyzCellNum[0] + 2))) 
-        {
-            ink -= 2 * xyzCellNum[2] * xyzCellNum[1];
-            if (ink < ((xyzCellNum[0] + 2) *xyzCellNum[2])) 
-            {
-                xyz[1] = 0;
-            }
-            else 
-            {
-                ink -= (xyzCellNum[0] + 2) * xyzCellNum[2];
-                xyz[1] = xyzCellNum[1] + 1;
-            }
-            xyz[0] = ink % (xyzCellNum[0] + 2);
-            xyz[2] = 1 + ink / (xyzCellNum[0] + 2);
-        }
-        else 
-        {
-            ink -= 2 * xyzCellNum[2] * (xyzCellNum[1] + xyzCellNum[0] + 2);
-            if (ink < ((xyzCellNum[0] + 2) * (xyzCellNum[1] + 2))) 
-            {
-                xyz[2] = 0;
-            }
-            else 
-            {
-                ink -= (xyzCellNum[0] + 2) * (xyzCellNum[1] + 2);
-                xyz[2] = xyzCellNum[2] + 1;
-            }
-            xyz[0] = ink % (xyzCellNum[0] + 2);
-            xyz[1] = ink / (xyzCellNum[0] + 2);
-        }
-        xyz[0]--;
-        xyz[1]--;
-        xyz[2]--;
-    }
+    int H = cells->haloDepth;
+    int* p = cells->padCellNum;
+    int pad = cells->cellToPad[num];
+
+    xyz[0] = pad % p[0] - H;
+    pad /= p[0];
+    xyz[1] = pad % p[1] - H;
+    xyz[2] = pad / p[1] - H;
+}
+
+// 根据细胞序号返回细胞原点(坐标最小的顶点)的坐标
+void getCellOrigin(Cell* cells, Spacial* space, int num, double3 origin){
+
+    int3 xyz;
+    getXYZByCell(cells, xyz, num);
+
+    for(int i = 0; i < 3; i++)
+        origin[i] = space->myMin[i] + xyz[i]*cells->cellLength[i];
+}
+
+// 内部细胞(不在本空间外侧H层内)中坐标小于k的个数, n为该维度上的细胞数
+static int interiorBefore(int k, int n, int H){
+
+    int m = k - H;
+    if (m < 0) m = 0;
+    if (m > n - 2*H) m = (n - 2*H > 0) ? n - 2*H : 0;
+    return m;
 }
 
 // 根据细胞位置xyz,返回在共享内存中的细胞序号,若不是共享内存内,则返回-1
+// 共享内存区域为本空间最外haloDepth层细胞, 序号为该细胞按x,y,z顺序排列的序号中去掉其前面的内部细胞后的位置;
+// 对各维度细胞数不足2*haloDepth的空间同样适用(此时本空间所有细胞都在共享内存区域内)
 int getSMCellByXYZ(Cell* cells, int* xyz){
 
-    int cell;
-
-    int t_myCellNum = (cells->xyzCellNum[0]-2) * (cells->xyzCellNum[1]-2) * (cells->xyzCellNum[2]-2);
-    int *xyzCellNum = cells->xyzCellNum;
-
-    int t_xyzNum[3];
-    int t_xyz[3];
-    t_xyzNum[0] = xyzCellNum[0]-2;
-    t_xyzNum[1] = xyzCellNum[1]-2;
-    t_xyzNum[2] = xyzCellNum[2]-2;
-
-    t_xyz[0] = xyz[0]-1;
-    t_xyz[1] = xyz[1]-1;
-    t_xyz[2] = xyz[2]-1;
-
-    int judge = (xyz[0]==0&&xyz[1]>=0&&xyz[1]<xyzCellNum[1]&&xyz[2]>=0&&xyz[2]<xyzCellNum[2])
-            +   ((xyz[0]==xyzCellNum[0]-1)&&xyz[1]>=0&&xyz[1]<xyzCellNum[1]&&xyz[2]>=0&&xyz[2]<xyzCellNum[2])
-            +   (xyz[1]==0&&xyz[0]>=0&&xyz[0]<xyzCellNum[0]&&xyz[2]>=0&&xyz[2]<xyzCellNum[2])
-            +   ((xyz[1]==xyzCellNum[1]-1)&&xyz[0]>=0&&xyz[0]<xyzCellNum[0]&&xyz[2]>=0&&xyz[2]<xyzCellNum[2])
-            +   (xyz[2]==0&&xyz[1]>=0&&xyz[1]<xyzCellNum[1]&&xyz[0]>=0&&xyz[0]<xyzCellNum[0])
-            +   ((xyz[2]==xyzCellNum[2]-1)&&xyz[1]>=0&&xyz[1]<xyzCellNum[1]&&xyz[0]>=0&&xyz[0]<xyzCellNum[0]);
-
-    //如果在共享内存范围内
-    if(judge){
-        
-
-        // Z轴正方向的共享内存区域
-        if (t_xyz[2] == t_xyzNum[2])
-            cell = t_myCellNum + 2*t_xyzNum[2]*t_xyzNum[1] + 2*t_xyzNum[2]*(t_xyzNum[0]+2) +
-                (t_xyzNum[0]+2)*(t_xyzNum[1]+2) + (t_xyzNum[0]+2)*(t_xyz[1]+1) + (t_xyz[0]+1);
-        // Z轴负方向的共享内存区域
-        else if (t_xyz[2] == -1)
-            cell = t_myCellNum + 2*t_xyzNum[2]*t_xyzNum[1] + 2*t_xyzNum[2]*(t_xyzNum[0]+2) +
-                (t_xyzNum[0]+2)*(t_xyz[1]+1) + (t_xyz[0]+1);
-        // Y轴正方向的共享内存区域
-        else if (t_xyz[1] == t_xyzNum[1])
-            cell = t_myCellNum + 2*t_xyzNum[2]*t_xyzNum[1] + t_xyzNum[2]*(t_xyzNum[0]+2) +
-                (t_xyzNum[0]+2)*t_xyz[2] + (t_xyz[0]+1);
-       // Y轴负方向的共享内存区域
-        else if (t_xyz[1] == -1)
-            cell = t_myCellNum + 2*t_xyzNum[2]*t_xyzNum[1] + t_xyz[2]*(t_xyzNum[0]+2) + (t_xyz[0]+1);
-       // X轴正方向的共享内存区域
-        else if (t_xyz[0] == t_xyzNum[0])
-            cell = t_myCellNum + t_xyzNum[1]*t_xyzNum[2] + t_xyz[2]*t_xyzNum[1] + t_xyz[1];
-       // X轴负方向的共享内存区域
-        else if (t_xyz[0] == -1)
-            cell = t_myCellNum + t_xyz[2]*t_xyzNum[1] + t_xyz[1];
-    }
-    else
-        return -1; //不在共享内存区域内，返回-1
+    int *n = cells->xyzCellNum;
+    int H = cells->haloDepth;
+
+    // 不在本空间内
+    for (int i = 0; i < 3; i++)
+        if (xyz[i] < 0 || xyz[i] >= n[i])
+            return -1;
 
-    return cell-1; 
+    // 各维度上是否为内部细胞
+    int inner[3];
+    for (int i = 0; i < 3; i++)
+        inner[i] = xyz[i] >= H && xyz[i] < n[i]-H;
 
+    if (inner[0] && inner[1] && inner[2])
+        return -1;
 
-} 
\ No newline at end of file
+    // 本空间中序号在其之前的内部细胞数
+    int m[3];
+    for (int i = 0; i < 3; i++)
+        m[i] = (n[i] - 2*H > 0) ? n[i] - 2*H : 0;
+    int before = interiorBefore(xyz[2], n[2], H)*m[0]*m[1];
+    if (inner[2])
+        before += interiorBefore(xyz[1], n[1], H)*m[0] + (inner[1] ? interiorBefore(xyz[0], n[0], H) : 0);
+
+    return xyz[0] + n[0]*(xyz[1] + n[1]*xyz[2]) - before;
+}
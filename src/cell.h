@@ -6,6 +6,20 @@
 
 #include "mytype.h"
 
+#include <stdint.h>
+
+// 每个空间在各维度上的最小长度(以截断距离为单位): 通信区域的厚度(邻居的haloDepth个细胞)不能小于截断距离
+#define MINCELLS 1
+
+// 自动选择分块大小时每个原子在作用力计算中访问的字节数(坐标、作用力、势能、id及类型)
+#define TILEBYTESPERATOM 64
+
+// 无法读取L2缓存大小时的默认值
+#define DEFAULTL2CACHE (256*1024)
+
+// 细胞槽位的最小余量, 每个细胞的槽位数为其原子数的1.25倍再加上此余量
+#define CELLSLACK 4
+
 struct SpacialStr;
 struct PotentialStr;
 struct CellStr;
@@ -14,6 +28,8 @@ struct CellStr;
 typedef struct CellStr{
 
 	int* atomNum;         // 本空间各细胞中的原子数
+	int* cellStart;       // 各细胞第一个槽位在原子数组中的下标, cellStart[c+1]-cellStart[c]为细胞c的槽位数
+	int slotNum;          // 所有细胞的总槽位数, 即原子数组的长度
 
 	int3 xyzCellNum;     // xyz各维度上的细胞数
    	int myCellNum;     // 本空间的细胞数
@@ -21,23 +37,70 @@ typedef struct CellStr{
    	int totalCellNum;   // 总细胞数 = 实际细胞数 + 通信细胞数
 
    	double3 cellLength;       // 细胞在各维度上的长度
-   	
+
+   	int mortonOrder;      // 本空间细胞的排列顺序: 0为x,y,z顺序, 1为Morton顺序
+   	int haloDepth;        // 细胞长度不小于截断距离的1/haloDepth, 通信区域为外侧haloDepth层细胞
+   	int3 padCellNum;      // 包括通信区域在内各维度上的细胞数, 即xyzCellNum + 2*haloDepth
+   	int3 cellMin;         // 各维度上原子可归入的细胞坐标范围: 通常为整个扩展区域,
+   	int3 cellMax;         // 在收缩包裹边界一侧只到本空间最外层细胞, 越出体系的原子留在该层中
+   	int* padToCell;       // 由扩展区域中的位置查细胞序号
+   	int* cellToPad;       // 由细胞序号查扩展区域中的位置
+
+   	int3 tileCellNum;     // 作用力计算分块在各维度上的细胞数
+   	int* sweep;           // 作用力计算中遍历本空间细胞的顺序: 逐块遍历, 块内按x,y,z顺序
+   	int activeNum;        // 本空间中有原子的细胞数
+   	int* active;          // 本空间中有原子的细胞, 按sweep的顺序排列, 每次原子交换后更新
+
+   	int stencilNum;       // 与截断球相交的邻居细胞数(包括自身)
+   	int* stencil;         // 各邻居细胞相对于本细胞在扩展区域中的位置偏移
+   	int innerStencilNum;  // 与多时间步积分内层截断球相交的邻居细胞数, 不使用多时间步时与stencilNum相同
+   	int* innerStencil;
 
 }Cell;
 
-// 初始化细胞链表
-void initCells(struct SpacialStr* space, struct PotentialStr* potential, struct CellStr** cel);
+// 初始化细胞链表, 细胞长度约为截断距离的1/cellDivision, mortonOrder为1时本空间细胞按Morton顺序排列
+void initCells(struct SpacialStr* space, struct PotentialStr* potential, int cellDivision, int mortonOrder,
+	struct CellStr** cel);
+
+// 释放细胞链表
+void freeCells(Cell* cells);
+
+// 按分块重新安排遍历本空间细胞的顺序, 使一个分块及其邻居细胞的数据能留在L2缓存中
+// tileSize为分块各维度上的细胞数, 为0时根据L2缓存大小和每个细胞的平均原子数自动选择
+void tileCells(Cell* cells, int tileSize, double atomsPerCell);
+
+// 原子数为count的细胞应分配的槽位数
+int cellCapacity(int count);
+
+// 由各细胞(包括通信区域)的原子数求各细胞的槽位数: 空细胞只有在相邻细胞中有原子时才保留最小余量,
+// 真空区域中的细胞不占槽位, 有原子进入时再扩容
+void cellCapacities(Cell* cells, const int* count, int* capacity);
+
+// 按sweep的顺序重新统计本空间中有原子的细胞
+void updateActiveCells(Cell* cells);
+
+// 按各细胞的槽位数重新计算各细胞的起始槽位(前缀和)
+void layoutCells(Cell* cells, int* capacity);
 
 // 根据坐标找到所在的细胞，返回细胞序号，即该空间中第几个细胞
 int findCellByCoord(Cell* cells, struct SpacialStr* space, double3 coord);
 
+// 批量求num个原子所在的细胞序号, 规则与findCellByCoord相同
+void findCellsByCoord(Cell* cells, struct SpacialStr* space, double3* coord, int num, int* cell);
+
 // 根据细胞位置xyz返回细胞序号，即该空间中第几个细胞
 int findCellByXYZ(Cell* cells, int* xyz);
 
 // 根据细胞序号返回细胞位置xyz,与函数findCellByXYZ互为逆过程
 void getXYZByCell(Cell* cells,int* xyz, int num);
 
+// 根据细胞序号返回细胞原点(坐标最小的顶点)的坐标
+void getCellOrigin(Cell* cells, struct SpacialStr* space, int num, double3 origin);
+
 // // 根据细胞位置xyz,返回在共享内存中的细胞序号,若不是共享内存内,则返回-1
 int getSMCellByXYZ(Cell* cells, int* xyz);
 
+// 将xyz坐标的各二进制位交错排列得到Morton码
+uint64_t mortonKey(int x, int y, int z);
+
 #endif
\ No newline at end of file
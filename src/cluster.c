@@ -0,0 +1,184 @@
+#include "cluster.h"
+#include "system.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// 原子在细胞中所处子格(各维度8等分)的Morton码, 用于把空间上相邻的原子分到同一个簇
+static int clusterKey(double3 pos, double3 origin, double* cellLength){
+
+	int key = 0;
+	for (int i = 0; i < 3; i++){
+		int q = (int)(8.0*(pos[i] - origin[i])/cellLength[i]);
+		q = q < 0 ? 0 : (q > 7 ? 7 : q);
+		for (int b = 0; b < 3; b++)
+			key |= ((q >> b) & 1) << (3*b + i);
+	}
+	return key;
+}
+
+// 保证可容纳clusterNum个簇
+static void reserveClusters(ClusterList* list, int clusterNum){
+
+	if (clusterNum <= list->clusterCap)
+		return;
+
+	int cap = clusterNum + clusterNum/4;
+	int atomCap = cap*CLUSTERSIZE;
+	list->x = (double*)realloc(list->x, atomCap*sizeof(double));
+	list->y = (double*)realloc(list->y, atomCap*sizeof(double));
+	list->z = (double*)realloc(list->z, atomCap*sizeof(double));
+	list->type = (int*)realloc(list->type, atomCap*sizeof(int));
+	list->slot = (int*)realloc(list->slot, atomCap*sizeof(int));
+	list->box = realloc(list->box, cap*sizeof(*list->box));
+	list->pairStart = (int*)realloc(list->pairStart, cap*sizeof(int));
+	list->pairEnd = (int*)realloc(list->pairEnd, cap*sizeof(int));
+	list->clusterCap = cap;
+}
+
+// 向簇对列表中添加一个邻居簇
+static void pushPair(ClusterList* list, int j){
+
+	if (list->pairNum == list->pairCap){
+		list->pairCap = list->pairCap ? 2*list->pairCap : 4096;
+		list->pairJ = (int*)realloc(list->pairJ, list->pairCap*sizeof(int));
+	}
+	list->pairJ[list->pairNum++] = j;
+}
+
+// 两个簇包围盒之间最短距离的平方
+static double boxDistance2(const double* a, const double* b){
+
+	double d2 = 0.0;
+	for (int i = 0; i < 3; i++){
+		double gap = a[i] > b[i+3] ? a[i] - b[i+3] : (b[i] > a[i+3] ? b[i] - a[i+3] : 0.0);
+		d2 += gap*gap;
+	}
+	return d2;
+}
+
+// 由当前细胞中的原子重新划分原子簇并建立簇对列表
+void buildClusters(struct SystemStr* sys){
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+	if (sys->clusters == NULL){
+		sys->clusters = (ClusterList*)malloc(sizeof(ClusterList));
+		memset(sys->clusters, 0, sizeof(ClusterList));
+	}
+	ClusterList* list = sys->clusters;
+
+	// 各细胞中的簇数
+	list->cellCluster = (int*)realloc(list->cellCluster, (cells->totalCellNum+1)*sizeof(int));
+	list->cellCluster[0] = 0;
+	for (int c = 0; c < cells->totalCellNum; c++)
+		list->cellCluster[c+1] = list->cellCluster[c] + (cells->atomNum[c] + CLUSTERSIZE-1)/CLUSTERSIZE;
+	list->clusterNum = list->cellCluster[cells->totalCellNum];
+	list->ownedClusterNum = list->cellCluster[cells->myCellNum];
+	reserveClusters(list, list->clusterNum);
+
+	// 细胞内的原子按子格的Morton码排序后依次分入各簇, 不足一簇的部分以空位补齐
+	int maxNum = 0;
+	for (int c = 0; c < cells->totalCellNum; c++)
+		if (cells->atomNum[c] > maxNum)
+			maxNum = cells->atomNum[c];
+	int* order = (int*)malloc((maxNum > 0 ? maxNum : 1)*sizeof(int));
+	int* key = (int*)malloc((maxNum > 0 ? maxNum : 1)*sizeof(int));
+
+	for (int c = 0; c < cells->totalCellNum; c++)
+	{
+		int num = cells->atomNum[c];
+		if (num == 0)
+			continue;
+
+		double3 origin;
+		getCellOrigin(cells, sys->space, c, origin);
+		int first = cells->cellStart[c];
+		for (int k = 0; k < num; k++){
+			int kk = clusterKey(atoms->pos[first+k], origin, cells->cellLength);
+			int j = k;
+			for (; j > 0 && key[j-1] > kk; j--){
+				key[j] = key[j-1];
+				order[j] = order[j-1];
+			}
+			key[j] = kk;
+			order[j] = first + k;
+		}
+
+		int base = list->cellCluster[c]*CLUSTERSIZE;
+		int total = (list->cellCluster[c+1] - list->cellCluster[c])*CLUSTERSIZE;
+		for (int k = 0; k < total; k++){
+			int n = k < num ? order[k] : -1;
+			list->slot[base+k] = n;
+			list->type[base+k] = n < 0 ? 0 : atoms->type[n];
+			list->x[base+k] = n < 0 ? CLUSTERFAR : atoms->pos[n][0];
+			list->y[base+k] = n < 0 ? CLUSTERFAR : atoms->pos[n][1];
+			list->z[base+k] = n < 0 ? CLUSTERFAR : atoms->pos[n][2];
+		}
+	}
+	free(order);
+	free(key);
+
+	// 各簇的包围盒(不含空位)
+	for (int ci = 0; ci < list->clusterNum; ci++){
+		double* box = list->box[ci];
+		int a0 = ci*CLUSTERSIZE;
+		box[0] = box[3] = list->x[a0];
+		box[1] = box[4] = list->y[a0];
+		box[2] = box[5] = list->z[a0];
+		for (int k = 1; k < CLUSTERSIZE && list->slot[a0+k] >= 0; k++){
+			double p[3] = {list->x[a0+k], list->y[a0+k], list->z[a0+k]};
+			for (int i = 0; i < 3; i++){
+				if (p[i] < box[i]) box[i] = p[i];
+				if (p[i] > box[i+3]) box[i+3] = p[i];
+			}
+		}
+	}
+
+	// 簇对列表: 遍历本空间细胞的邻居细胞中的簇, 包围盒之间的距离小于截断距离时记录
+	// 启用作用力回传时, 与通信区域细胞的簇对只在细胞偏移为正的一侧记录, 对侧进程看到的偏移符号相反
+	double rCut2 = sys->potential->cutoff*sys->potential->cutoff;
+	int newton = sys->potential->newton;
+	list->pairNum = 0;
+	for (int k1 = 0; k1 < cells->activeNum; k1++)
+	{
+		int cell1 = cells->active[k1];
+		int pad1 = cells->cellToPad[cell1];
+		for (int ci = list->cellCluster[cell1]; ci < list->cellCluster[cell1+1]; ci++)
+		{
+			list->pairStart[ci] = list->pairNum;
+			for (int s = 0; s < cells->stencilNum; s++)
+			{
+				int cell2 = cells->padToCell[pad1 + cells->stencil[s]];
+				if (cell2 >= cells->myCellNum && newton && cells->stencil[s] < 0)
+					continue;
+				int cj = list->cellCluster[cell2];
+				if (cell2 < cells->myCellNum && cj < ci)
+					cj = ci;   // 本空间的簇对只记录一次
+				for (; cj < list->cellCluster[cell2+1]; cj++)
+					if (boxDistance2(list->box[ci], list->box[cj]) < rCut2)
+						pushPair(list, cj);
+			}
+			list->pairEnd[ci] = list->pairNum;
+		}
+	}
+}
+
+// 释放原子簇数据
+void freeClusters(ClusterList* list){
+
+	if (! list)
+		return;
+	free(list->x);
+	free(list->y);
+	free(list->z);
+	free(list->type);
+	free(list->slot);
+	free(list->box);
+	free(list->cellCluster);
+	free(list->pairStart);
+	free(list->pairEnd);
+	free(list->pairJ);
+	free(list);
+}
@@ -0,0 +1,53 @@
+// cluster.h
+// 原子簇对(cluster pair)作用力计算所需的数据: 将每个细胞中空间上相邻的原子分为固定大小的簇,
+// 以簇的包围盒筛选簇对, 每个簇对的CLUSTERSIZE x CLUSTERSIZE次相互作用一次算完, 循环中没有分支
+
+#ifndef CLUSTER_H_
+#define CLUSTER_H_
+
+#include "mytype.h"
+
+// 每个簇中的原子数
+#define CLUSTERSIZE 4
+
+// 簇中空位的坐标, 与任何原子的距离都大于截断距离
+#define CLUSTERFAR 1.0e10
+
+struct SystemStr;
+
+typedef struct ClusterListStr{
+
+	int clusterNum;        // 簇的总数
+	int ownedClusterNum;   // 本空间细胞中的簇数, 这些簇排在前面
+	int clusterCap;        // 已分配的簇数
+
+	// 各簇中原子的数据, 第c个簇的第k个原子下标为 c*CLUSTERSIZE+k
+	double* x;
+	double* y;
+	double* z;
+	int* type;
+	int* slot;             // 原子在原子数组中的槽位, 空位为-1
+
+	double (*box)[6];      // 各簇的包围盒: 各维度的最小值, 最大值
+	int* cellCluster;      // 各细胞的第一个簇, cellCluster[c+1]-cellCluster[c]为细胞c中的簇数
+
+	// 簇对列表: 本空间的簇i的邻居簇为 pairJ[pairStart[i] .. pairEnd[i]), 按细胞遍历顺序依次存储
+	// 两个簇都在本空间时只记录序号不小于i的簇; 启用作用力回传时, 通信区域的簇只在细胞偏移为正的一侧记录
+	int* pairStart;
+	int* pairEnd;
+	int* pairJ;
+	int pairNum;
+	int pairCap;
+
+}ClusterList;
+
+// 由当前细胞中的原子重新划分原子簇并建立簇对列表
+// 每步都须重建: 每步的原子交换都会重建通信区域, 其中原子的槽位随之改变, 簇及簇对列表不能跨步保留;
+// 引入带缓冲层(skin)的重建间隔需要通信区域跨步保留并只传递坐标, 而原子交换不提供这种方式;
+// 重建只是对各细胞原子的一遍插入排序(每个细胞只有几十个原子)及对邻居簇包围盒的比较, 开销远小于簇对作用力计算本身
+void buildClusters(struct SystemStr* sys);
+
+// 释放原子簇数据
+void freeClusters(ClusterList* list);
+
+#endif
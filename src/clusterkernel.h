@@ -0,0 +1,101 @@
+// clusterkernel.h
+// 簇对作用力计算的循环模板, 由potential.c多次包含, 为每种对势生成各自的簇对力计算函数
+// 每个簇对的CLUSTERSIZE x CLUSTERSIZE次相互作用以定长循环算完: 超出截断距离、空位及重复的原子对
+// 用掩码置零而不是跳过, 使内层循环没有分支, 可由编译器整体向量化
+// 每次包含前需定义:
+//   CLUSTER_KERNEL_NAME         生成的函数名
+//   PAIR_EVAL(pot, ij, r2, e, fr)   与pairkernel.h相同
+// 启用跨边界的作用力回传(pot.newton)时, 与通信区域簇的簇对已在buildClusters中只保留一侧
+// 本文件不设包含保护
+
+static void CLUSTER_KERNEL_NAME(struct SystemStr* sys){
+
+	const Potential pot = *sys->potential;
+	double rCut2 = pot.cutoff*pot.cutoff;
+
+	buildClusters(sys);
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+	const ClusterList* list = sys->clusters;
+
+	for (int k1 = 0; k1 < cells->activeNum; k1++)
+	{
+		int cell1 = cells->active[k1];
+		for (int ci = list->cellCluster[cell1]; ci < list->cellCluster[cell1+1]; ci++)
+		{
+			int a0 = ci*CLUSTERSIZE;
+			double xi[CLUSTERSIZE], yi[CLUSTERSIZE], zi[CLUSTERSIZE];
+			double fxi[CLUSTERSIZE] = {0.0}, fyi[CLUSTERSIZE] = {0.0}, fzi[CLUSTERSIZE] = {0.0};
+			double ei[CLUSTERSIZE] = {0.0};
+			int ti[CLUSTERSIZE], si[CLUSTERSIZE];
+			for (int i = 0; i < CLUSTERSIZE; i++){
+				si[i] = list->slot[a0+i];
+				xi[i] = list->x[a0+i];
+				yi[i] = list->y[a0+i];
+				zi[i] = list->z[a0+i];
+				ti[i] = list->type[a0+i]*pot.typeNum;
+			}
+
+			for (int p = list->pairStart[ci]; p < list->pairEnd[ci]; p++)
+			{
+				int cj = list->pairJ[p];
+				int b0 = cj*CLUSTERSIZE;
+				int self = cj == ci;
+				double fxj[CLUSTERSIZE] = {0.0}, fyj[CLUSTERSIZE] = {0.0}, fzj[CLUSTERSIZE] = {0.0};
+				double ej[CLUSTERSIZE] = {0.0};
+
+				for (int i = 0; i < CLUSTERSIZE; i++)
+					for (int j = 0; j < CLUSTERSIZE; j++)
+					{
+						double dx = xi[i] - list->x[b0+j];
+						double dy = yi[i] - list->y[b0+j];
+						double dz = zi[i] - list->z[b0+j];
+						double r2 = dx*dx + dy*dy + dz*dz;
+
+						// 空位的槽位为-1; 同一簇内只计算j>i的原子对
+						int valid = (si[i] | list->slot[b0+j]) >= 0;
+						double mask = (valid && r2 < rCut2 && (! self || j > i)) ? 1.0 : 0.0;
+						double rs = mask > 0.0 ? r2 : rCut2;
+
+						double e, fr;
+						PAIR_EVAL(&pot, ti[i] + list->type[b0+j], rs, &e, &fr);
+						e *= mask;
+						fr *= mask;
+
+						fxi[i] -= dx*fr;
+						fyi[i] -= dy*fr;
+						fzi[i] -= dz*fr;
+						fxj[j] += dx*fr;
+						fyj[j] += dy*fr;
+						fzj[j] += dz*fr;
+						ei[i] += 0.5*e;
+						ej[j] += 0.5*e;
+					}
+
+				for (int j = 0; j < CLUSTERSIZE; j++){
+					int n2 = list->slot[b0+j];
+					if (n2 < 0)
+						break;
+					atoms->force[n2][0] += fxj[j];
+					atoms->force[n2][1] += fyj[j];
+					atoms->force[n2][2] += fzj[j];
+					atoms->pot[n2] += ej[j];
+				}
+			}
+
+			for (int i = 0; i < CLUSTERSIZE; i++){
+				int n1 = list->slot[a0+i];
+				if (n1 < 0)
+					break;
+				atoms->force[n1][0] += fxi[i];
+				atoms->force[n1][1] += fyi[i];
+				atoms->force[n1][2] += fzi[i];
+				atoms->pot[n1] += ei[i];
+			}
+		}
+	}
+}
+
+#undef CLUSTER_KERNEL_NAME
+#undef PAIR_EVAL
@@ -3,11 +3,19 @@
 #include "atom.h"
 #include "system.h"
 #include "mympi.h"
+#include "timer.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
 
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 
+static int cellSlots(struct CellStr* cells, int* list, int num);
+static int beyondOpenFace(struct CellStr* cells, const int* neighborProc, int cell);
+static int* findMigrateCells(struct CellStr* cells, const int* neighborProc, enum Neighbor dimen, int* num);
+static int packCells(struct SystemStr* sys, void* buf, int* cellList, int cellNum, enum Neighbor dimen);
+
 // 初始化结构体
 void initComm(DataComm** comm, struct SpacialStr* space, struct CellStr* cells){
 
@@ -34,31 +42,39 @@ void initComm(DataComm** comm, struct SpacialStr* space, struct CellStr* cells){
     datacomm->neighborProc[Z_POS] = myPos[0] + globalProcNum[0] *
     	( myPos[1] + globalProcNum[1]*((myPos[2] +1 + globalProcNum[2]) % globalProcNum[2]));
 
+    // 非周期性维度上位于体系两端的进程在该侧没有邻居
+    for (int i=0; i<3; i++){
+        if (space->periodic[i])
+            continue;
+        if (myPos[i] == 0)
+            datacomm->neighborProc[2*i] = MPI_PROC_NULL;
+        if (myPos[i] == globalProcNum[i]-1)
+            datacomm->neighborProc[2*i+1] = MPI_PROC_NULL;
+    }
+
     // if (ifZeroRank())
     // 	for(int i=0;i<6;i++)
     // 		printf("%d ",datacomm->neighborProc[i]);
 
-    // 各方向需要通信的细胞数的最大值
-    int maxComm = MAX((xyzCellNum[0]+2)*(xyzCellNum[1]+2),
-    	MAX((xyzCellNum[1]+2)*(xyzCellNum[2]+2),
-    		(xyzCellNum[0]+2)*(xyzCellNum[2]+2)));
-    datacomm->bufSize = 2*maxComm*MAXPERCELL*sizeof(AtomData); //可改进为每个面需要自己的细胞数量
-
-    datacomm->commCellNum[X_NEG] = 2*(xyzCellNum[1]+2)*(xyzCellNum[2]+2)-xyzCellNum[1]*xyzCellNum[2];
-   	datacomm->commCellNum[X_POS] = 2*(xyzCellNum[1]+2)*(xyzCellNum[2]+2)-xyzCellNum[1]*xyzCellNum[2];
-   	datacomm->commCellNum[Y_NEG] = 2*(xyzCellNum[0]+2)*(xyzCellNum[2]+2)-xyzCellNum[0]*xyzCellNum[2];
-   	datacomm->commCellNum[Y_POS]  = 2*(xyzCellNum[0]+2)*(xyzCellNum[2]+2)-xyzCellNum[0]*xyzCellNum[2];
-   	datacomm->commCellNum[Z_NEG]  = 2*(xyzCellNum[0]+2)*(xyzCellNum[1]+2)-xyzCellNum[0]*xyzCellNum[1];
-   	datacomm->commCellNum[Z_POS]  = 2*(xyzCellNum[0]+2)*(xyzCellNum[1]+2)-xyzCellNum[0]*xyzCellNum[1];
-
-    datacomm->sharedCellNum[X_NEG] = xyzCellNum[1]*xyzCellNum[2];
-    datacomm->sharedCellNum[X_POS] = xyzCellNum[1]*xyzCellNum[2];
-    datacomm->sharedCellNum[Y_NEG] = xyzCellNum[0]*xyzCellNum[2];
-    datacomm->sharedCellNum[Y_POS]  = xyzCellNum[0]*xyzCellNum[2];
-    datacomm->sharedCellNum[Z_NEG]  = xyzCellNum[0]*xyzCellNum[1];
-    datacomm->sharedCellNum[Z_POS]  = xyzCellNum[0]*xyzCellNum[1];
-
-    datacomm->smsize = 2*(xyzCellNum[1]*xyzCellNum[2]+xyzCellNum[0]*xyzCellNum[2]
+    int H = cells->haloDepth;
+    int* padCellNum = cells->padCellNum;
+
+    // 各方向的通信细胞为该方向外侧H层及内侧H层细胞, 去掉内侧属于共享内存区域的细胞
+    datacomm->commCellNum[X_NEG] = 2*H*padCellNum[1]*padCellNum[2]-H*xyzCellNum[1]*xyzCellNum[2];
+   	datacomm->commCellNum[X_POS] = 2*H*padCellNum[1]*padCellNum[2]-H*xyzCellNum[1]*xyzCellNum[2];
+   	datacomm->commCellNum[Y_NEG] = 2*H*padCellNum[0]*padCellNum[2]-H*xyzCellNum[0]*xyzCellNum[2];
+   	datacomm->commCellNum[Y_POS]  = 2*H*padCellNum[0]*padCellNum[2]-H*xyzCellNum[0]*xyzCellNum[2];
+   	datacomm->commCellNum[Z_NEG]  = 2*H*padCellNum[0]*padCellNum[1]-H*xyzCellNum[0]*xyzCellNum[1];
+   	datacomm->commCellNum[Z_POS]  = 2*H*padCellNum[0]*padCellNum[1]-H*xyzCellNum[0]*xyzCellNum[1];
+
+    datacomm->sharedCellNum[X_NEG] = H*xyzCellNum[1]*xyzCellNum[2];
+    datacomm->sharedCellNum[X_POS] = H*xyzCellNum[1]*xyzCellNum[2];
+    datacomm->sharedCellNum[Y_NEG] = H*xyzCellNum[0]*xyzCellNum[2];
+    datacomm->sharedCellNum[Y_POS]  = H*xyzCellNum[0]*xyzCellNum[2];
+    datacomm->sharedCellNum[Z_NEG]  = H*xyzCellNum[0]*xyzCellNum[1];
+    datacomm->sharedCellNum[Z_POS]  = H*xyzCellNum[0]*xyzCellNum[1];
+
+    datacomm->smsize = 2*H*(xyzCellNum[1]*xyzCellNum[2]+xyzCellNum[0]*xyzCellNum[2]
         +xyzCellNum[0]*xyzCellNum[1]);
 
    	for (int dimen=0; dimen<6; dimen++){
@@ -66,6 +82,47 @@ void initComm(DataComm** comm, struct SpacialStr* space, struct CellStr* cells){
       datacomm->sharedCells[dimen] = findSMCells(cells, dimen, datacomm->sharedCellNum[dimen]);
     }
 
+    // 开放边界一侧不发送也不接收; 其余方向的通信细胞中去掉开放边界外侧的细胞, 越出体系的原子不再转发
+    for (int dimen=0; dimen<6; dimen++){
+      if (datacomm->neighborProc[dimen] == MPI_PROC_NULL){
+        datacomm->commCellNum[dimen] = 0;
+        datacomm->sharedCellNum[dimen] = 0;
+        continue;
+      }
+      int n = 0;
+      for (int i=0; i<datacomm->commCellNum[dimen]; i++)
+        if (! beyondOpenFace(cells, datacomm->neighborProc, datacomm->commCells[dimen][i]))
+          datacomm->commCells[dimen][n++] = datacomm->commCells[dimen][i];
+      datacomm->commCellNum[dimen] = n;
+    }
+
+    for (int dimen=0; dimen<6; dimen++)
+      datacomm->migrateCells[dimen] = findMigrateCells(cells, datacomm->neighborProc, dimen, &datacomm->migrateCellNum[dimen]);
+
+    datacomm->lostCellNum = 0;
+    datacomm->lostCells = (int*)malloc((cells->totalCellNum - cells->myCellNum)*sizeof(int));
+    for (int cell=cells->myCellNum; cell<cells->totalCellNum; cell++)
+      if (beyondOpenFace(cells, datacomm->neighborProc, cell))
+        datacomm->lostCells[datacomm->lostCellNum++] = cell;
+
+    // 缓冲区初始大小按对应细胞的槽位数估计, 交换原子时不足再扩大
+    int smSlots = 0;
+    int maxComm = 0;
+    for (int dimen=0; dimen<6; dimen++){
+      smSlots += cellSlots(cells, datacomm->sharedCells[dimen], datacomm->sharedCellNum[dimen]);
+      if (dimen%2 == 1)
+        maxComm = MAX(maxComm, cellSlots(cells, datacomm->commCells[dimen-1], datacomm->commCellNum[dimen-1])
+          + cellSlots(cells, datacomm->commCells[dimen], datacomm->commCellNum[dimen]));
+    }
+    datacomm->smBufSize = smSlots*sizeof(AtomData);
+    datacomm->bufSize = maxComm*sizeof(AtomData);
+
+    // 初始化槽位链表
+    memset(&datacomm->smSend, 0, sizeof(SlotList));
+    memset(datacomm->smRecv, 0, 6*sizeof(SlotList));
+    memset(datacomm->send, 0, 6*sizeof(SlotList));
+    memset(datacomm->recv, 0, 6*sizeof(SlotList));
+
     //test
     // int n,m,p;
     // int3 xyz;
@@ -89,23 +146,84 @@ void initComm(DataComm** comm, struct SpacialStr* space, struct CellStr* cells){
     // }
 }
 
+// 释放结构体空间
+void freeComm(DataComm* comm){
+
+    if (! comm)
+        return;
+    free(comm->smSend.slot);
+    free(comm->lostCells);
+    for (int i=0; i<6; i++){
+        free(comm->commCells[i]);
+        free(comm->migrateCells[i]);
+        free(comm->sharedCells[i]);
+        free(comm->smRecv[i].slot);
+        free(comm->send[i].slot);
+        free(comm->recv[i].slot);
+    }
+    free(comm);
+}
+
+// 一组细胞的总槽位数
+static int cellSlots(struct CellStr* cells, int* list, int num){
+
+	int slots = 0;
+	for (int i=0; i<num; i++)
+		slots += cells->cellStart[list[i]+1] - cells->cellStart[list[i]];
+	return slots;
+}
+
+// 细胞是否位于开放边界(没有邻居进程的一侧)外侧的通信区域中
+static int beyondOpenFace(struct CellStr* cells, const int* neighborProc, int cell){
+
+	int3 xyz;
+	getXYZByCell(cells, xyz, cell);
+	for (int i=0; i<3; i++){
+		if (xyz[i] < 0 && neighborProc[2*i] == MPI_PROC_NULL)
+			return 1;
+		if (xyz[i] >= cells->xyzCellNum[i] && neighborProc[2*i+1] == MPI_PROC_NULL)
+			return 1;
+	}
+	return 0;
+}
+
+// 找出指定方向上迁移原子的细胞, 即该方向外侧H层的全部细胞; 开放边界一侧没有迁移细胞
+static int* findMigrateCells(struct CellStr* cells, const int* neighborProc, enum Neighbor dimen, int* num){
+
+	int d = dimen/2;
+	int* list = (int*)malloc((cells->totalCellNum - cells->myCellNum)*sizeof(int));
+	*num = 0;
+	if (neighborProc[dimen] == MPI_PROC_NULL)
+		return list;
+
+	for (int cell=cells->myCellNum; cell<cells->totalCellNum; cell++){
+		int3 xyz;
+		getXYZByCell(cells, xyz, cell);
+		int outside = dimen%2 == 0 ? xyz[d] < 0 : xyz[d] >= cells->xyzCellNum[d];
+		if (outside && ! beyondOpenFace(cells, neighborProc, cell))
+			list[(*num)++] = cell;
+	}
+	return list;
+}
+
 // 找出指定维度上所有通信部分的细胞
 int* findCommCells(struct CellStr* cells, enum Neighbor dimen, int num){
 	
 	int* commcells = malloc(num*sizeof(int));
-   	int xBegin = -1;
-   	int xEnd   = cells->xyzCellNum[0]+1;
-   	int yBegin = -1;
-   	int yEnd   = cells->xyzCellNum[1]+1;
-   	int zBegin = -1;
-   	int zEnd   = cells->xyzCellNum[2]+1;
-
-   	if (dimen == X_NEG) xEnd = xBegin+2;
-   	if (dimen == X_POS) xBegin = xEnd-2;
-   	if (dimen == Y_NEG) yEnd = yBegin+2;
-   	if (dimen == Y_POS) yBegin = yEnd-2;
-   	if (dimen == Z_NEG) zEnd = zBegin+2;
-   	if (dimen == Z_POS) zBegin = zEnd-2;
+   	int H = cells->haloDepth;
+   	int xBegin = -H;
+   	int xEnd   = cells->xyzCellNum[0]+H;
+   	int yBegin = -H;
+   	int yEnd   = cells->xyzCellNum[1]+H;
+   	int zBegin = -H;
+   	int zEnd   = cells->xyzCellNum[2]+H;
+
+   	if (dimen == X_NEG) xEnd = xBegin+2*H;
+   	if (dimen == X_POS) xBegin = xEnd-2*H;
+   	if (dimen == Y_NEG) yEnd = yBegin+2*H;
+   	if (dimen == Y_POS) yBegin = yEnd-2*H;
+   	if (dimen == Z_NEG) zEnd = zBegin+2*H;
+   	if (dimen == Z_POS) zBegin = zEnd-2*H;
 
    	int n = 0;
    	int3 xyz;
@@ -123,19 +241,20 @@ int* findCommCells(struct CellStr* cells, enum Neighbor dimen, int num){
 int* findSMCells(struct CellStr* cells, enum Neighbor dimen, int num){
 
     int* smcells = malloc(num*sizeof(int));
-    int xBegin = -1;
-    int xEnd   = cells->xyzCellNum[0]+1;
-    int yBegin = -1;
-    int yEnd   = cells->xyzCellNum[1]+1;
-    int zBegin = -1;
-    int zEnd   = cells->xyzCellNum[2]+1;
-
-    if (dimen == X_NEG) xEnd = xBegin+2;
-    if (dimen == X_POS) xBegin = xEnd-2;
-    if (dimen == Y_NEG) yEnd = yBegin+2;
-    if (dimen == Y_POS) yBegin = yEnd-2;
-    if (dimen == Z_NEG) zEnd = zBegin+2;
-    if (dimen == Z_POS) zBegin = zEnd-2;
+    int H = cells->haloDepth;
+    int xBegin = -H;
+    int xEnd   = cells->xyzCellNum[0]+H;
+    int yBegin = -H;
+    int yEnd   = cells->xyzCellNum[1]+H;
+    int zBegin = -H;
+    int zEnd   = cells->xyzCellNum[2]+H;
+
+    if (dimen == X_NEG) xEnd = xBegin+2*H;
+    if (dimen == X_POS) xBegin = xEnd-2*H;
+    if (dimen == Y_NEG) yEnd = yBegin+2*H;
+    if (dimen == Y_POS) yBegin = yEnd-2*H;
+    if (dimen == Z_NEG) zEnd = zBegin+2*H;
+    if (dimen == Z_POS) zBegin = zEnd-2*H;
 
     int n = 0;
     int3 xyz;
@@ -149,14 +268,12 @@ int* findSMCells(struct CellStr* cells, enum Neighbor dimen, int num){
     return smcells;
 }
 
-// 将待发送的原子数据加入缓冲区内,返回加入缓冲区内的数据个数
-int addSendData(struct SystemStr* sys, void* buf, enum Neighbor dimen){
+// 将一组细胞中的原子数据加入发往dimen方向的缓冲区内, 越过周期性边界时平移坐标
+static int packCells(struct SystemStr* sys, void* buf, int* cellList, int cellNum, enum Neighbor dimen){
 
 	int num = 0;
    	AtomData* buffer = (AtomData*) buf; // 可改进为拥有自己的缓冲区
     
-   	int commCellNum = sys->datacomm->commCellNum[dimen]; 	
-   	int* commCells = sys->datacomm->commCells[dimen];
    	int* spacePos = sys->space->position;
    	int* spaceNum = sys->space->globalProcNum;
 
@@ -185,32 +302,49 @@ int addSendData(struct SystemStr* sys, void* buf, enum Neighbor dimen){
    	if(spacePos[2] == spaceNum[2]-1 && dimen == Z_POS)
    		boundaryAdjust[2] = -1.0*sys->space->globalLength[2];
    
-   	for (int nCell=0; nCell<commCellNum; nCell++)
+   	for (int nCell=0; nCell<cellNum; nCell++)
    	{
-      	int cell = commCells[nCell];
+      	int cell = cellList[nCell];
 
-      	for (int n=cell*MAXPERCELL,count=0; count<sys->cells->atomNum[cell]; n++,count++)
+      	for (int n=sys->cells->cellStart[cell],count=0; count<sys->cells->atomNum[cell]; n++,count++)
       	{
       		for(int i=0;i<3;i++){
       			buffer[num].pos[i] = sys->atoms->pos[n][i]+boundaryAdjust[i];
       			buffer[num].momenta[i] = sys->atoms->momenta[n][i];
       		}
         	buffer[num].id  = sys->atoms->id[n];
+        	buffer[num].type = sys->atoms->type[n];
+        	pushSlot(&sys->datacomm->send[dimen], n);
          	num++;
       	}
    	}
    return num;
 }
 
-// 处理已接收的其他进程的原子数据
-void procRecvData(struct SystemStr* sys, void* buf, int size){
+// 将待发送的原子数据加入缓冲区内,返回加入缓冲区内的数据个数
+int addSendData(struct SystemStr* sys, void* buf, enum Neighbor dimen){
+
+	DataComm* comm = sys->datacomm;
+	return packCells(sys, buf, comm->commCells[dimen], comm->commCellNum[dimen], dimen);
+}
+
+// 将迁移细胞中的原子数据加入缓冲区内, 返回加入缓冲区内的数据个数
+int addMigrateData(struct SystemStr* sys, void* buf, enum Neighbor dimen){
+
+	DataComm* comm = sys->datacomm;
+	return packCells(sys, buf, comm->migrateCells[dimen], comm->migrateCellNum[dimen], dimen);
+}
+
+// 处理已接收的其他进程的原子数据, dimen为发送方缓冲区中对应部分的方向
+void procRecvData(struct SystemStr* sys, void* buf, int size, enum Neighbor dimen){
 	
 	AtomData* buffer = (AtomData*) buf;
 
 	double3 pos; //原子坐标
 	double3 momenta; //原子动量
 
-	int id;
+	bigint id;
+	int type;
 	for (int num=0; num<size; num++)
    	{     	
       	for(int i=0;i<3;i++)
@@ -219,6 +353,7 @@ void procRecvData(struct SystemStr* sys, void* buf, int size){
       		momenta[i] = buffer[num].momenta[i];
       	}
       	id = buffer[num].id;
+      	type = buffer[num].type;
       	
       	// 将原子分配至对应的细胞中
         //  if(getMyRank()==2){
@@ -226,7 +361,223 @@ void procRecvData(struct SystemStr* sys, void* buf, int size){
         //     printf("pos: %g,%g,%g\n",pos[0],pos[1],pos[2] );
         //     printf("momenta: %g,%g,%g\n",momenta[0],momenta[1],momenta[2] );
         // }
-      	assignAtom(id, pos, sys, momenta);
-        
+      	int n = assignAtom(id, type, pos, sys, momenta);
+      	pushSlot(&sys->datacomm->recv[dimen], n);
    	}
 }
+
+// 邻居进程共享内存窗口的起始地址; 开放边界一侧没有邻居, 返回全零的头部, 从中读出的原子数均为0
+char* neighborBuf(MPI_Win win, int rank){
+
+	static int emptyHeader[6] = {0};
+	if (rank == MPI_PROC_NULL)
+		return (char*)emptyHeader;
+
+	MPI_Aint size;
+	int disp;
+	char* buf = NULL;
+	MPI_Win_shared_query(win, rank, &size, &disp, &buf);
+	return buf;
+}
+
+// 向槽位链表中添加一个槽位
+void pushSlot(SlotList* list, int slot){
+
+	if (list->num == list->cap){
+		list->cap = list->cap ? 2*list->cap : 256;
+		list->slot = (int*)realloc(list->slot, list->cap*sizeof(int));
+	}
+	list->slot[list->num++] = slot;
+}
+
+// 原子数组重新划分后, 按新旧槽位的对应关系更新所有记录的槽位
+void remapCommSlots(DataComm* comm, int* slotMap){
+
+	SlotList* lists[25];
+	int num = 0;
+	lists[num++] = &comm->smSend;
+	for (int i=0; i<6; i++){
+		lists[num++] = &comm->smRecv[i];
+		lists[num++] = &comm->send[i];
+		lists[num++] = &comm->recv[i];
+	}
+	for (int l=0; l<num; l++)
+		for (int k=0; k<lists[l]->num; k++)
+			lists[l]->slot[k] = slotMap[lists[l]->slot[k]];
+}
+
+// 清空所有记录的槽位, 每次原子交换前调用
+void clearCommSlots(DataComm* comm){
+
+	comm->smSend.num = 0;
+	for (int i=0; i<6; i++){
+		comm->smRecv[i].num = 0;
+		comm->send[i].num = 0;
+		comm->recv[i].num = 0;
+	}
+}
+
+// 将本空间原子的附加数据(每个原子一个double)沿原子交换的路径传递给邻居进程的通信区域
+// 原子迁移在建立通信区域之前已完成, 交换中接收的原子均为通信区域中的副本
+void haloForward(struct SystemStr* sys, double* data){
+
+	DataComm* comm = sys->datacomm;
+
+	char* buf1 = NULL;
+	char* buf2 = NULL;
+	int counts[2];
+
+	beginTimer(communication);
+
+	// 共享内存部分: 共享缓冲区中的原子均属于发送方, 可一次全部读取
+	double* smOut = (double*)(sys->smBuf + 6*sizeof(int));
+	for (int k=0; k<comm->smSend.num; k++)
+		smOut[k] = data[comm->smSend.slot[k]];
+	MPI_Win_fence(0, sys->win1);
+
+	for (int dimen=0; dimen<6; dimen++){
+
+		// 第dimen部分来自对侧方向的邻居
+		int neighbor = comm->neighborProc[dimen%2 == 0 ? dimen+1 : dimen-1];
+		buf1 = neighborBuf(sys->win1, neighbor);
+
+		int header[6];
+		memcpy(header, buf1, 6*sizeof(int));
+		int begin = (dimen == 0) ? 0 : header[dimen-1];
+		double* in = (double*)(buf1 + 6*sizeof(int));
+		SlotList* list = &comm->smRecv[dimen];
+		for (int k=0; k<list->num; k++)
+			data[list->slot[k]] = in[begin+k];
+	}
+	MPI_Win_fence(0, sys->win1);
+
+	// 通信区域部分: 按维度依次转发, 后一维度会转发前一维度收到的数据
+	for (int dimen=0; dimen<3; dimen++){
+
+		int neg_dimen = 2*dimen;
+		int pos_dimen = 2*dimen+1;
+
+		counts[0] = comm->send[neg_dimen].num;
+		counts[1] = comm->send[pos_dimen].num;
+		memcpy(sys->usrBuf, counts, 2*sizeof(int));
+		double* out = (double*)(sys->usrBuf + 2*sizeof(int));
+		for (int k=0; k<counts[0]; k++)
+			out[k] = data[comm->send[neg_dimen].slot[k]];
+		for (int k=0; k<counts[1]; k++)
+			out[counts[0]+k] = data[comm->send[pos_dimen].slot[k]];
+		MPI_Win_fence(0, sys->win2);
+
+		// 负方向邻居发送缓冲区中的正方向部分
+		buf1 = neighborBuf(sys->win2, comm->neighborProc[neg_dimen]);
+		memcpy(counts, buf1, 2*sizeof(int));
+		double* in = (double*)(buf1 + 2*sizeof(int)) + counts[0];
+		SlotList* list = &comm->recv[pos_dimen];
+		for (int k=0; k<list->num; k++)
+			data[list->slot[k]] = in[k];
+
+		// 正方向邻居发送缓冲区中的负方向部分
+		buf2 = neighborBuf(sys->win2, comm->neighborProc[pos_dimen]);
+		in = (double*)(buf2 + 2*sizeof(int));
+		list = &comm->recv[neg_dimen];
+		for (int k=0; k<list->num; k++)
+			data[list->slot[k]] = in[k];
+
+		MPI_Win_fence(0, sys->win2);
+	}
+
+	endTimer(communication);
+}
+
+// 逆向通信中每个原子的数据: 所受的力及势能, 须不超过半个AtomData, 见reverseGhostForce
+typedef struct GhostForceStr{
+
+	double3 force;
+	double pot;
+
+}GhostForce;
+
+// 将slot处的力及势能写入entry
+static void packForce(Atom* atoms, int slot, GhostForce* entry){
+
+	for (int i=0; i<3; i++)
+		entry->force[i] = atoms->force[slot][i];
+	entry->pot = atoms->pot[slot];
+}
+
+// 将entry中的力及势能累加至slot处
+static void addForce(Atom* atoms, int slot, const GhostForce* entry){
+
+	for (int i=0; i<3; i++)
+		atoms->force[slot][i] += entry->force[i];
+	atoms->pot[slot] += entry->pot;
+}
+
+// 将通信区域原子所受的力及势能沿原子交换的路径逆向传回其属主进程并累加
+// 按z, y, x的顺序逆向传递: 各进程写出其接收链表中通信区域原子的值, 发送方读取后累加,
+// 后一维度转发的原子先把值传回转发者, 再由转发者随前一维度传回属主
+void reverseGhostForce(struct SystemStr* sys){
+
+	DataComm* comm = sys->datacomm;
+	Atom* atoms = sys->atoms;
+
+	// 无需检查缓冲区大小: 各进程窗口大小相同, 每一维度写出的原子来自两个邻居的两部分发送数据,
+	// 各部分不超过一个窗口的AtomData, 而GhostForce不超过半个AtomData
+	beginTimer(communication);
+
+	char* buf1 = NULL;
+	char* buf2 = NULL;
+	int counts[2];
+
+	for (int dimen=2; dimen>=0; dimen--){
+
+		int neg_dimen = 2*dimen;
+		int pos_dimen = 2*dimen+1;
+
+		// 写出接收链表中原子的值: recv[neg_dimen]来自正方向邻居, recv[pos_dimen]来自负方向邻居
+		counts[0] = comm->recv[neg_dimen].num;
+		counts[1] = comm->recv[pos_dimen].num;
+		memcpy(sys->usrBuf, counts, 2*sizeof(int));
+		GhostForce* out = (GhostForce*)(sys->usrBuf + 2*sizeof(int));
+		for (int part=0; part<2; part++){
+			SlotList* list = &comm->recv[part == 0 ? neg_dimen : pos_dimen];
+			for (int k=0; k<list->num; k++, out++)
+				packForce(atoms, list->slot[k], out);
+		}
+
+		// 共享内存部分: smRecv[neg_dimen]来自正方向邻居, smRecv[pos_dimen]来自负方向邻居
+		counts[0] = comm->smRecv[neg_dimen].num;
+		counts[1] = comm->smRecv[pos_dimen].num;
+		memcpy(sys->smBuf, counts, 2*sizeof(int));
+		out = (GhostForce*)(sys->smBuf + 2*sizeof(int));
+		for (int part=0; part<2; part++){
+			SlotList* list = &comm->smRecv[part == 0 ? neg_dimen : pos_dimen];
+			for (int k=0; k<list->num; k++, out++)
+				packForce(atoms, list->slot[k], out);
+		}
+		MPI_Win_fence(0, sys->win1);
+		MPI_Win_fence(0, sys->win2);
+
+		// 发送链表send[neg_dimen]由负方向邻居接收, send[pos_dimen]由正方向邻居接收
+		for (int part=0; part<2; part++){
+			int dir = part == 0 ? neg_dimen : pos_dimen;
+			buf1 = neighborBuf(sys->win2, comm->neighborProc[dir]);
+			memcpy(counts, buf1, 2*sizeof(int));
+			GhostForce* in = (GhostForce*)(buf1 + 2*sizeof(int)) + (part == 0 ? 0 : counts[0]);
+			SlotList* list = &comm->send[dir];
+			for (int k=0; k<list->num; k++)
+				addForce(atoms, list->slot[k], &in[k]);
+
+			// 本空间共享内存中dir方向部分的原子由该方向的邻居读取
+			buf2 = neighborBuf(sys->win1, comm->neighborProc[dir]);
+			memcpy(counts, buf2, 2*sizeof(int));
+			in = (GhostForce*)(buf2 + 2*sizeof(int)) + (part == 0 ? 0 : counts[0]);
+			int begin = (dir == 0) ? 0 : comm->smPartEnd[dir-1];
+			for (int k=0; k<comm->smPartEnd[dir]-begin; k++)
+				addForce(atoms, comm->smSend.slot[begin+k], &in[k]);
+		}
+		MPI_Win_fence(0, sys->win1);
+		MPI_Win_fence(0, sys->win2);
+	}
+
+	endTimer(communication);
+}
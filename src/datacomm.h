@@ -5,24 +5,46 @@
 
 #include "mytype.h"
 
+#include <mpi.h>
+
 struct SpacialStr;
 struct CellStr;
 struct SystemStr;
 
+// 原子槽位链表, 记录原子在本空间原子数组中的下标
+typedef struct SlotListStr{
+
+	int num;
+	int cap;
+	int* slot;
+
+}SlotList;
+
 typedef struct DataCommStr{
 
-	// 邻居进程的序号
+	// 邻居进程的序号, 非周期性边界一侧没有邻居时为MPI_PROC_NULL
 	int neighborProc[6];
 
-	// 各个维度的缓冲区大小
+	// 开放边界外侧的通信区域细胞: 该侧不接收邻居的原子, 其中只有越出体系边界的原子, 交换后丢弃
+	int lostCellNum;
+	int* lostCells;
+
+	// 各个维度的缓冲区大小(字节, 不含头部), 不足时由reserveCommWindows扩大
 	int bufSize;
 
+	// 共享内存缓冲区大小(字节, 不含头部)
+	int smBufSize;
+
 	// 各方向上需要通信的细胞数量
 	int commCellNum[6];
 
 	// 各方向上通信的细胞链表
 	int *commCells[6];
 
+	// 各方向上迁移原子的细胞: 该方向外侧的H层细胞, 其中的原子已移出本空间
+	int migrateCellNum[6];
+	int *migrateCells[6];
+
 	// 内存共享细胞数量
 	int smsize;
 
@@ -32,12 +54,21 @@ typedef struct DataCommStr{
 	// 各方向上内存共享的细胞链表
 	int *sharedCells[6];
 
+	// 原子交换时记录的槽位，之后可沿相同路径传递原子的附加数据(如EAM的嵌入能导数)
+	// 接收链表的下标为发送方缓冲区中对应部分的方向
+	SlotList smSend;     // 写入本进程共享缓冲区的原子
+	SlotList smRecv[6];  // 从邻居共享缓冲区接收的原子
+	SlotList send[6];    // 写入各方向发送缓冲区的原子
+	SlotList recv[6];    // 从邻居发送缓冲区接收的原子
+	int smPartEnd[6];    // smSend中各方向部分的结束位置
+
 }DataComm;
 
 // 需要通信的原子数据
 typedef struct atomDataStr{
 
-	int id;
+	bigint id;
+	int type; // 原子类型
 	double3 pos; // 原子坐标
 	double3 momenta; // 原子动量
 
@@ -50,6 +81,9 @@ enum Neighbor{
 // 初始化结构体
 void initComm(DataComm** comm, struct SpacialStr* space, struct CellStr* cells);
 
+// 释放结构体空间
+void freeComm(DataComm* comm);
+
 // 找出指定维度上所有通信部分的细胞
 int* findCommCells(struct CellStr* cells, enum Neighbor dimen, int num);
 
@@ -59,7 +93,28 @@ int* findSMCells(struct CellStr* cells, enum Neighbor dimen, int num);
 // 将待发送的原子数据加入缓冲区内,返回加入缓冲区内的数据个数
 int addSendData(struct SystemStr* sys, void* buf, enum Neighbor dimen);
 
-// 处理已接收的其他进程的原子数据
-void procRecvData(struct SystemStr* sys, void* buf, int size);
+// 将迁移细胞中的原子数据加入缓冲区内, 返回加入缓冲区内的数据个数
+int addMigrateData(struct SystemStr* sys, void* buf, enum Neighbor dimen);
+
+// 处理已接收的其他进程的原子数据, dimen为发送方缓冲区中对应部分的方向
+void procRecvData(struct SystemStr* sys, void* buf, int size, enum Neighbor dimen);
+
+// 邻居进程共享内存窗口的起始地址; 开放边界一侧没有邻居, 返回全零的头部, 从中读出的原子数均为0
+char* neighborBuf(MPI_Win win, int rank);
+
+// 向槽位链表中添加一个槽位
+void pushSlot(SlotList* list, int slot);
+
+// 原子数组重新划分后, 按新旧槽位的对应关系更新所有记录的槽位
+void remapCommSlots(DataComm* comm, int* slotMap);
+
+// 清空所有记录的槽位, 每次原子交换前调用
+void clearCommSlots(DataComm* comm);
+
+// 将本空间原子的附加数据(每个原子一个double)沿原子交换的路径传递给邻居进程的通信区域
+void haloForward(struct SystemStr* sys, double* data);
+
+// 将通信区域原子所受的力及势能沿原子交换的路径逆向传回其属主进程并累加
+void reverseGhostForce(struct SystemStr* sys);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "eam.h"
+#include "system.h"
+#include "cell.h"
+#include "atom.h"
+#include "datacomm.h"
+#include "memory.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// 依次读取n个数值, 数值之间可以跨行
+static int readValues(FILE* f, int n, double* values){
+
+	for (int i = 0; i < n; i++)
+		if (fscanf(f, "%lf", &values[i]) != 1)
+			return 0;
+	return 1;
+}
+
+// 读取一行, 去掉行尾的换行符
+static int readLine(FILE* f, char* line, int size){
+
+	if (fgets(line, size, f) == NULL)
+		return 0;
+	line[strcspn(line, "\r\n")] = '\0';
+	return 1;
+}
+
+// 由等间距网格上的数据生成关于r的插值表, 从下标first开始使用数据
+static PotTable* gridTable(const double* values, int num, double dr, int first,
+	double cutoff, int tablePoints){
+
+	double* r = (double*)malloc(num*sizeof(double));
+	for (int i = 0; i < num; i++)
+		r[i] = i*dr;
+
+	PairSpline* sp = makePairSpline(num-first, r+first, values+first);
+	PotTable* table = buildPotTable(pairSplineEval, sp, TABLE_RMIN, cutoff, tablePoints, 1);
+
+	freePairSpline(sp);
+	free(r);
+	return table;
+}
+
+// 读取EAM势函数文件(自动识别setfl/funcfl格式), 失败时返回NULL
+EamPot* readEamPot(const char* path, int tablePoints){
+
+	FILE* f = fopen(path, "r");
+	if (f == NULL)
+		return NULL;
+
+	char line[5][256];
+	for (int i = 0; i < 5; i++)
+		if (! readLine(f, line[i], 256)){
+			fclose(f);
+			return NULL;
+		}
+
+	EamPot* eam = (EamPot*)malloc(sizeof(EamPot));
+	memset(eam, 0, sizeof(EamPot));
+
+	int nRho, nR, z;
+	double dRho, dR, a0;
+	char latticeType[16];
+
+	// funcfl: 注释行; "Z 质量 晶格常数 晶格类型"; "Nrho drho Nr dr 截断距离"
+	if (sscanf(line[1], "%d %lf %lf %15s", &z, &eam->mass[0], &a0, latticeType) == 4 &&
+		sscanf(line[2], "%d %lf %d %lf %lf", &nRho, &dRho, &nR, &dR, &eam->cutoff) == 5){
+
+		strcpy(eam->format, "funcfl");
+		eam->elemNum = 1;
+		strcpy(eam->elemName[0], "--");
+
+		// 前5行中第4行起已是数据, 回到第3行末尾重新读取
+		rewind(f);
+		for (int i = 0; i < 3; i++)
+			readLine(f, line[0], 256);
+	}
+	// setfl: 3行注释; "元素数 元素名..."; "Nrho drho Nr dr 截断距离"
+	else if (sscanf(line[3], "%d", &eam->elemNum) == 1 &&
+		sscanf(line[4], "%d %lf %d %lf %lf", &nRho, &dRho, &nR, &dR, &eam->cutoff) == 5 &&
+		eam->elemNum >= 1 && eam->elemNum <= EAM_MAXELEM){
+
+		strcpy(eam->format, "setfl");
+		char* token = strtok(line[3], " \t");
+		for (int i = 0; i < eam->elemNum; i++){
+			token = strtok(NULL, " \t");
+			strncpy(eam->elemName[i], token ? token : "--", 3);
+		}
+	}
+	else{
+		fclose(f);
+		free(eam);
+		return NULL;
+	}
+
+	double* rhoGrid = (double*)malloc(nRho*sizeof(double));
+	for (int i = 0; i < nRho; i++)
+		rhoGrid[i] = i*dRho;
+	double* values = (double*)malloc((nRho > nR ? nRho : nR)*sizeof(double));
+	double* zr = (double*)malloc(nR*sizeof(double));
+	int ok = 1;
+
+	for (int e = 0; e < eam->elemNum && ok; e++){
+
+		// setfl每个元素前有一行"Z 质量 晶格常数 晶格类型"
+		if (strcmp(eam->format, "setfl") == 0)
+			ok = fscanf(f, "%d %lf %lf %15s", &z, &eam->mass[e], &a0, latticeType) == 4;
+
+		ok = ok && readValues(f, nRho, values);
+		if (ok)
+			eam->embed[e] = makePairSpline(nRho, rhoGrid, values);
+
+		// funcfl在F(ρ)之后是有效电荷Z(r), 之后才是ρ(r)
+		if (ok && strcmp(eam->format, "funcfl") == 0)
+			ok = readValues(f, nR, zr);
+
+		ok = ok && readValues(f, nR, values);
+		if (ok)
+			eam->rho[e] = gridTable(values, nR, dR, 0, eam->cutoff, tablePoints);
+	}
+
+	if (ok && strcmp(eam->format, "funcfl") == 0){
+		// φ(r) = 27.2*0.529*Z(r)^2/r
+		for (int i = 1; i < nR; i++)
+			values[i] = 27.2*0.529*zr[i]*zr[i]/(i*dR);
+		eam->phi[0] = gridTable(values, nR, dR, 1, eam->cutoff, tablePoints);
+	}
+	else if (ok){
+		// setfl中按下三角顺序给出 r*φ_ij(r)
+		for (int i = 0; i < eam->elemNum && ok; i++)
+			for (int j = 0; j <= i && ok; j++){
+				ok = readValues(f, nR, values);
+				for (int k = 1; k < nR && ok; k++)
+					values[k] /= k*dR;
+				if (ok){
+					PotTable* table = gridTable(values, nR, dR, 1, eam->cutoff, tablePoints);
+					eam->phi[i*eam->elemNum+j] = table;
+					eam->phi[j*eam->elemNum+i] = table;
+				}
+			}
+	}
+
+	free(rhoGrid);
+	free(values);
+	free(zr);
+	fclose(f);
+
+	if (! ok){
+		freeEamPot(eam);
+		return NULL;
+	}
+	return eam;
+}
+
+// 释放结构体空间
+void freeEamPot(EamPot* eam){
+
+	if (! eam)
+		return;
+
+	for (int i = 0; i < eam->elemNum; i++){
+		freePotTable(eam->rho[i]);
+		freePairSpline(eam->embed[i]);
+		for (int j = 0; j < i; j++)
+			freePotTable(eam->phi[i*eam->elemNum+j]);
+		freePotTable(eam->phi[i*eam->elemNum+i]);
+	}
+	freeBlock(eam->rhobar);
+	freeBlock(eam->dfEmbed);
+	free(eam->pairs);
+	free(eam);
+}
+
+// 计算EAM作用力: 电子密度 -> 通信区域的嵌入能导数 -> 作用力
+// 第一遍遍历细胞求电子密度和对势能, 并记录截断距离内的原子对及导数;
+// 第二遍只遍历记录的原子对, 开销与对势相当
+void computeForceEam(struct SystemStr* sys){
+
+	EamPot* eam = sys->potential->eam;
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+	int* typeMap = eam->typeMap;
+	double rCut2 = eam->cutoff*eam->cutoff;
+
+	int slotNum = cells->slotNum;
+	if (slotNum > eam->slotNum){
+		eam->slotNum = slotNum;
+		freeBlock(eam->rhobar);
+		freeBlock(eam->dfEmbed);
+		eam->rhobar = (double*)allocBlock(slotNum*sizeof(double));
+		eam->dfEmbed = (double*)allocBlock(slotNum*sizeof(double));
+	}
+	for (int c = 0; c < cells->totalCellNum; c++)
+		for (int i = cells->cellStart[c], count = 0; count < cells->atomNum[c]; count++, i++){
+			eam->rhobar[i] = 0.0;
+			eam->dfEmbed[i] = 0.0;
+		}
+
+	// 第一遍: 电子密度与对势能
+	eam->pairNum = 0;
+   	for (int k1 = 0; k1<cells->activeNum; k1++)
+   	{
+      	int cell1 = cells->active[k1];
+      	int atomnum1 = cells->atomNum[cell1];
+      	if ( atomnum1 == 0 ) 
+      		continue;
+
+      	int pad1 = cells->cellToPad[cell1];
+
+   		// 只遍历与截断球相交的邻居细胞
+   		for (int s = 0; s < cells->stencilNum; s++)
+   				{
+   					int cell2 = cells->padToCell[pad1 + cells->stencil[s]];
+   					int atomnum2 = cells->atomNum[cell2];
+   					if ( atomnum2 == 0 ) 
+      					continue;
+
+      				for (int n1=cells->cellStart[cell1],count1=0; count1<atomnum1; count1++,n1++)
+         			{
+         				int e1 = typeMap[atoms->type[n1]];
+         				for (int n2=cells->cellStart[cell2],count2=0; count2<atomnum2; count2++,n2++)
+            			{
+           					if (cell2 < cells->myCellNum && n2 <= n1 )
+                  				continue; // 防止重复计算
+
+           					double r2 = 0.0;
+                  			for (int i=0; i<3; i++)
+               				{ 
+               					double d = atoms->pos[n1][i]-atoms->pos[n2][i];
+                  				r2 += d*d;
+               				}
+               				if ( r2 > rCut2 )
+               					continue;
+
+               				if (eam->pairNum == eam->pairCap){
+               					eam->pairCap = eam->pairCap ? 2*eam->pairCap : 4096;
+               					eam->pairs = (EamPair*)realloc(eam->pairs, eam->pairCap*sizeof(EamPair));
+               				}
+               				EamPair* pair = &eam->pairs[eam->pairNum++];
+
+               				int e2 = typeMap[atoms->type[n2]];
+               				double rho1, rho2, phi;
+               				potTableEval(eam->rho[e2], r2, &rho1, &pair->drho1);
+               				if (e2 == e1){
+               					rho2 = rho1;
+               					pair->drho2 = pair->drho1;
+               				}
+               				else
+               					potTableEval(eam->rho[e1], r2, &rho2, &pair->drho2);
+               				potTableEval(eam->phi[e1*eam->elemNum+e2], r2, &phi, &pair->dphi);
+               				pair->n1 = n1;
+               				pair->n2 = n2;
+
+               				eam->rhobar[n1] += rho1;
+               				eam->rhobar[n2] += rho2;
+               				atoms->pot[n1] += 0.5*phi;
+               				atoms->pot[n2] += 0.5*phi;
+   						}  
+            		}
+         		}
+    }
+
+    // 本空间原子的嵌入能及其导数
+   	for (int k=0; k<cells->activeNum; k++)
+      	for (int nCell=cells->active[k],n=cells->cellStart[nCell],count=0; count<cells->atomNum[nCell]; count++,n++)
+      	{
+      		double f, df;
+      		pairSplineEval(eam->embed[typeMap[atoms->type[n]]], eam->rhobar[n], &f, &df);
+      		atoms->pot[n] += f;
+      		eam->dfEmbed[n] = df;
+      	}
+
+    // 通信区域中原子的嵌入能导数由其所属进程传来
+    haloForward(sys, eam->dfEmbed);
+
+    // 第二遍: 作用力
+    for (int p = 0; p < eam->pairNum; p++)
+    {
+    	EamPair* pair = &eam->pairs[p];
+    	int n1 = pair->n1;
+    	int n2 = pair->n2;
+    	double fr = pair->dphi + eam->dfEmbed[n1]*pair->drho1 + eam->dfEmbed[n2]*pair->drho2;
+    	for (int m=0; m<3; m++)
+    	{
+    		double d = atoms->pos[n1][m]-atoms->pos[n2][m];
+    		atoms->force[n1][m] -= d*fr;
+    		atoms->force[n2][m] += d*fr;
+    	}
+    }
+}
@@ -0,0 +1,57 @@
+// eam.h
+// 嵌入原子势(EAM): 读取setfl/funcfl格式的势函数文件, 分两遍计算作用力
+
+#ifndef EAM_H_
+#define EAM_H_
+
+#include "table.h"
+#include "lattice.h"
+
+#define EAM_MAXELEM 8 // 势函数文件中元素种数的最大值
+
+struct SystemStr;
+
+// 一对截断距离内的原子, 及第一遍中求得的导数, 第二遍直接使用
+typedef struct EamPairStr{
+
+	int n1;
+	int n2;
+	double dphi;   // φ'(r)/r
+	double drho1;  // n2所属元素的ρ'(r)/r, 即n2对n1处电子密度的贡献
+	double drho2;  // n1所属元素的ρ'(r)/r
+
+}EamPair;
+
+typedef struct EamPotStr{
+
+	char format[8];                 // 文件格式: setfl 或 funcfl
+	int elemNum;                    // 元素种数
+	char elemName[EAM_MAXELEM][4];  // 元素名称
+	double mass[EAM_MAXELEM];       // 相对原子质量
+	double cutoff;                  // 截断距离
+	int typeMap[MAXTYPES];          // 各原子类型对应的元素在文件中的下标
+
+	PotTable* rho[EAM_MAXELEM];                // 电子密度 ρ(r), 以插值表存储
+	PotTable* phi[EAM_MAXELEM*EAM_MAXELEM];    // 对势 φ(r), 以插值表存储
+	PairSpline* embed[EAM_MAXELEM];            // 嵌入能 F(ρ)
+
+	int slotNum;       // 以下各原子数组的长度
+	double* rhobar;    // 各原子所在处的电子密度
+	double* dfEmbed;   // 各原子的嵌入能导数 F'(ρ)
+
+	int pairNum;       // 第一遍记录的原子对数
+	int pairCap;
+	EamPair* pairs;
+
+}EamPot;
+
+// 读取EAM势函数文件(自动识别setfl/funcfl格式), 失败时返回NULL
+EamPot* readEamPot(const char* path, int tablePoints);
+
+// 释放结构体空间
+void freeEamPot(EamPot* eam);
+
+// 计算EAM作用力: 电子密度 -> 通信区域的嵌入能导数 -> 作用力
+void computeForceEam(struct SystemStr* sys);
+
+#endif
@@ -1,8 +1,10 @@
 #include "energy.h"
 #include "system.h"
+#include "mympi.h"
 
 #include <mpi.h>
 #include <stdlib.h>
+#include <math.h>
 
 // 初始化结构体
 void initEnergy(Energy** ener){
@@ -11,25 +13,95 @@ void initEnergy(Energy** ener){
     Energy* energy = *ener;
 
     energy->kineticEnergy = 0.0;
-    //energy->potentialEnergy = 0.0;
+    energy->potentialEnergy = 0.0;
+
+    energy->driftSamples = 0;
+    energy->initialEnergy = 0.0;
+    energy->sumDrift = 0.0;
+    energy->maxDrift = 0.0;
+    energy->sumT = 0.0;
+    energy->sumE = 0.0;
+    energy->sumTT = 0.0;
+    energy->sumTE = 0.0;
 }
 
 // 计算体系的总动能
 void computeTotalKinetic(struct SystemStr* sys){
 
 	double myKineticEnergy = 0.0;
-	double globalKineticEnergy = 0.0;
-	double atomM = sys->lattice->atomM;
+	double* invM = sys->lattice->invM;
 
 	// 计算本空间的原子总动能
-   	for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-      	for (int n=MAXPERCELL*nCell,count=0; count<sys->cells->atomNum[nCell]; count++,n++)
+   	for (int k=0; k<sys->cells->activeNum; k++)
+      	for (int nCell=sys->cells->active[k],n=sys->cells->cellStart[nCell],count=0; count<sys->cells->atomNum[nCell]; count++,n++)
       		for(int i=0; i<3; i++)
          		myKineticEnergy += sys->atoms->momenta[n][i]*sys->atoms->momenta[n][i]
-         			*0.5/atomM;
+         			*0.5*invM[sys->atoms->type[n]];
+
+   	sumTotalKinetic(sys->energy, myKineticEnergy);
+}
+
+// 由各进程本空间的原子动能求体系的总动能
+void sumTotalKinetic(Energy* energy, double myKineticEnergy){
+
+	double globalKineticEnergy = 0.0;
 
     // AllReduce, 得到整个体系的总动能
     MPI_Allreduce(&myKineticEnergy, &globalKineticEnergy, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-   	sys->energy->kineticEnergy = globalKineticEnergy;
-}
\ No newline at end of file
+   	energy->kineticEnergy = globalKineticEnergy;
+}
+
+// 计算体系的总势能, 各原子势能在computeForce中求得
+void computeTotalPotential(struct SystemStr* sys){
+
+	double myPotentialEnergy = 0.0;
+	double globalPotentialEnergy = 0.0;
+
+   	for (int k=0; k<sys->cells->activeNum; k++)
+      	for (int nCell=sys->cells->active[k],n=sys->cells->cellStart[nCell],count=0; count<sys->cells->atomNum[nCell]; count++,n++)
+         	myPotentialEnergy += sys->atoms->pot[n];
+
+    MPI_Allreduce(&myPotentialEnergy, &globalPotentialEnergy, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+   	sys->energy->potentialEnergy = globalPotentialEnergy;
+}
+
+// 记录当前时刻(fs)的总能量，用于统计能量漂移
+void sampleEnergyDrift(Energy* energy, double time){
+
+	double e = energy->kineticEnergy + energy->potentialEnergy;
+
+	if (energy->driftSamples == 0)
+		energy->initialEnergy = e;
+
+	double drift = fabs(e - energy->initialEnergy)/fabs(energy->initialEnergy);
+	energy->sumDrift += drift;
+	if (drift > energy->maxDrift)
+		energy->maxDrift = drift;
+
+	energy->sumT += time;
+	energy->sumE += e;
+	energy->sumTT += time*time;
+	energy->sumTE += time*e;
+	energy->driftSamples++;
+}
+
+// 打印能量漂移的统计结果
+void printEnergyDrift(FILE* f, Energy* energy, bigint totalAtom){
+
+	if (! ifZeroRank() || energy->driftSamples == 0)
+        return;
+
+	int m = energy->driftSamples;
+	double slope = 0.0;
+	double denom = m*energy->sumTT - energy->sumT*energy->sumT;
+	if (m > 1 && denom != 0.0)
+		slope = (m*energy->sumTE - energy->sumT*energy->sumE)/denom;
+
+	fprintf(f, "---能量漂移统计(%d 次采样):---\n", m);
+	fprintf(f, "平均相对漂移  : %g\n", energy->sumDrift/m);
+	fprintf(f, "最大相对漂移  : %g\n", energy->maxDrift);
+	fprintf(f, "线性漂移率    : %g eV/原子/ps\n", slope*1000.0/totalAtom);
+	fprintf(f, "----------------\n");
+}
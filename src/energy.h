@@ -4,11 +4,25 @@
 #ifndef ENERGY_H_
 #define ENERGY_H_
 
+#include "mytype.h"
+
+#include <stdio.h>
+
 struct SystemStr;
 typedef struct EnergyStr{
 
 	double kineticEnergy;
-	//double potentialEnergy;
+	double potentialEnergy;
+
+	// 能量漂移统计(NVE模拟中总能量应守恒)
+	int driftSamples;      // 采样次数
+	double initialEnergy;  // 第一次采样时的总能量
+	double sumDrift;       // |E-E0|/|E0| 的累加值
+	double maxDrift;       // |E-E0|/|E0| 的最大值
+	double sumT;           // 线性拟合 E(t) 所需的累加量
+	double sumE;
+	double sumTT;
+	double sumTE;
 
 }Energy;
 
@@ -18,4 +32,16 @@ void initEnergy(Energy** ener);
 // 计算体系的总动能
 void computeTotalKinetic(struct SystemStr* sys);
 
-#endif
\ No newline at end of file
+// 由各进程本空间的原子动能求体系的总动能, 用于在更新动量的同时求得动能
+void sumTotalKinetic(Energy* energy, double myKineticEnergy);
+
+// 计算体系的总势能
+void computeTotalPotential(struct SystemStr* sys);
+
+// 记录当前时刻(fs)的总能量，用于统计能量漂移
+void sampleEnergyDrift(Energy* energy, double time);
+
+// 打印能量漂移的统计结果
+void printEnergyDrift(FILE* f, Energy* energy, bigint totalAtom);
+
+#endif
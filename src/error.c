@@ -6,6 +6,28 @@
 const char* errInfo[errNums] ={
 	"no error",
 	"xProcNum * yProcNum * zProcNum != rankNum",
+	"unknown potentialName",
+	"cannot read potentialFile",
+	"unknown element in elements or potentialFile",
+	"unknown speciesMode",
+	"no process grid gives every subdomain at least one cutoff-sized cell per dimension",
+	"cellDivision must be a positive integer",
+	"unknown rebinMode",
+	"unknown cellOrder",
+	"unknown forceEngine",
+	"respaSteps > 1 needs a pair potential",
+	"respaCutoff must be below cutoff and above respaSwitch",
+	"boundary must be three letters of p (periodic), f (fixed) or s (shrink-wrapped)",
+	"unknown hugePages",
+	"unknown affinity",
+	"cannot read initFile, or its atoms do not match the header",
+	"unknown initFormat",
+	"parameter value too long",
+	"cannot read the input file, or a parameter in it or on the command line is too long",
+	"unknown parameter name",
+	"atoms of initFile lie outside the box in a fixed (f) dimension",
+	"unknown interpolation",
+	"tablePoints must be at least 2",
 
 };
 
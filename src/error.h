@@ -8,6 +8,28 @@ enum ErrorPtr{
 
 	normal,
 	procNum,
+	potName,
+	potFile,
+	elemName,
+	speciesMode,
+	procGrid,
+	cellDiv,
+	rebinMode,
+	cellOrder,
+	forceEngine,
+	respaPot,
+	respaCutoff,
+	boundary,
+	hugePages,
+	affinity,
+	initFile,
+	initFormat,
+	paraLength,
+	inputFile,
+	inputName,
+	initRange,
+	interpolation,
+	tablePoints,
 	errNums
 };
 
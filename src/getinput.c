@@ -6,24 +6,54 @@
 //              参数名字与参数值用 = 号连接                                           
 //               = 号前后不能有空格                                       
 //              每行最大字符数为 LINE_MAX_LENGTH                          
-//              参数名最大字符数为 NAME_MAX_LENGTH,超长将丢弃该参数       
-//              参数值最大字符数为 VALUE_MAX_LENGTH,超长将截断  
+//              参数名最大字符数为 NAME_MAX_LENGTH, 参数值最大字符数为 VALUE_MAX_LENGTH,
+//              超长时报告该参数且不读入  
 //              当参数值为'default'时，使用默认参数值       
+//              文件只由0号进程读取一次, 参数表广播给其他进程
 /**************************************************************************/
 #include "getinput.h"
 
-// 从输入文件中读取单独一个参数对应的值                                    
-// 参数：文件路径; 参数名称; 存储空间                        
-// 返回：0,未找到; 1,找到符合名称的值; 2,使用默认值
-int getInputValue(const char* file_path, const char* para_name,
-    char* buff)
+// 参数表中名为para_name的参数的序号, 没有时返回-1
+static int findInput(const InputTable* table, const char* para_name){
+
+    for (int i = 0; i < table->num; i++)
+        if (strcmp(table->name[i], para_name) == 0)
+            return i;
+    return -1;
+}
+
+// 加入或覆盖一个参数
+// 返回：1,成功; 0,参数名或参数值超长, 或参数表已满, 参数表不变
+static int putInput(InputTable* table, const char* para_name, const char* value, int replace){
+
+    if (strlen(para_name) > NAME_MAX_LENGTH || strlen(value) > VALUE_MAX_LENGTH) {
+        fprintf(stdout, "Parameter too long: %.*s\n", NAME_MAX_LENGTH, para_name);
+        return 0;
+    }
+
+    int i = findInput(table, para_name);
+    if (i >= 0 && ! replace)
+        return 1;
+    if (i < 0){
+        if (table->num == INPUT_MAX_ITEMS) {
+            fprintf(stdout, "Too many parameters: %s\n", para_name);
+            return 0;
+        }
+        i = table->num++;
+        snprintf(table->name[i], sizeof(table->name[i]), "%s", para_name);
+    }
+    snprintf(table->value[i], sizeof(table->value[i]), "%s", value);
+    return 1;
+}
+
+// 读取输入文件中的所有参数并加入参数表, 同名参数以文件中第一次出现的为准
+// 返回：0,文件无法打开; 1,成功; -1,参数名或参数值超长, 或参数表已满
+int readInputFile(const char* file_path, InputTable* table)
 {
     char linebuf[LINE_MAX_LENGTH];
-    char line_name[NAME_MAX_LENGTH];
-    char* sign = "=";
-    char* leave_line;
+    char line_name[NAME_MAX_LENGTH+1];
     FILE* f;
-    int flag = 0, len;
+    int status = 1;
 
     f = fopen(file_path, "r");
     if (f == NULL) {
@@ -31,8 +61,16 @@ int getInputValue(const char* file_path, const char* para_name,
         return 0;
     }
 
-    fseek(f, 0, SEEK_SET);
     while (fgets(linebuf, LINE_MAX_LENGTH, f) != NULL) {
+        if (strchr(linebuf, '\n') == NULL && ! feof(f)) { //超长的行, 丢弃其余部分
+            fprintf(stdout, "Line too long in InputFile: %.*s\n", NAME_MAX_LENGTH, linebuf);
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n')
+                ;
+            status = -1;
+            continue;
+        }
+
         if (strlen(linebuf) < 4) { //去除空行 
             continue;
         }
@@ -45,40 +83,46 @@ int getInputValue(const char* file_path, const char* para_name,
             linebuf[strlen(linebuf) - 1] = '\0';
         }
 
-        memset(line_name, 0, sizeof(line_name));
-        leave_line = strstr(linebuf, sign);
+        char* leave_line = strchr(linebuf, '=');
         if (leave_line == NULL) { //去除无"="的情况
             continue;
         }
 
         int leave_num = leave_line - linebuf;
         if (leave_num > NAME_MAX_LENGTH) {
+            fprintf(stdout, "Parameter too long: %.*s\n", NAME_MAX_LENGTH, linebuf);
+            status = -1;
             continue;
         }
 
-        strncpy(line_name, linebuf, leave_num);
-        if (strcmp(line_name, para_name) == 0) {
-            len = strlen(linebuf) - leave_num - 1;
-            len = len > VALUE_MAX_LENGTH ? VALUE_MAX_LENGTH : len;
-            strncpy(buff, linebuf + (leave_num + 1),
-                len);
-            *(buff + len) = '\0';
-            if(strcmp(buff,"default") == 0){
-                flag = 2;
-                break;
-            }
-            flag = 1;
-            break;
-        }
-
-        if (fgetc(f) == EOF){
-            break;
-        }
-
-        fseek(f, -1, SEEK_CUR);
-        memset(linebuf, 0, sizeof(linebuf));
+        memcpy(line_name, linebuf, leave_num);
+        line_name[leave_num] = '\0';
+        if (! putInput(table, line_name, leave_line + 1, 0))
+            status = -1;
     }
 
     fclose(f);
-    return flag;
+    return status;
+}
+
+// 设置参数表中的一个参数, 已有同名参数时覆盖其值(用于命令行参数)
+int setInputValue(InputTable* table, const char* para_name, const char* value){
+
+    return putInput(table, para_name, value, 1);
+}
+
+// 从参数表中查找单独一个参数对应的值, 并将该参数标记为已查找
+// 参数：参数表; 参数名称; 存储空间(至少VALUE_MAX_LENGTH+1个字符)
+// 返回：0,未找到; 1,找到符合名称的值; 2,使用默认值
+int getInputValue(InputTable* table, const char* para_name, char* buff)
+{
+    int i = findInput(table, para_name);
+    if (i < 0)
+        return 0;
+
+    table->used[i] = 1;
+    strcpy(buff, table->value[i]);
+    if (strcmp(buff, "default") == 0)
+        return 2;
+    return 1;
 }
@@ -7,14 +7,33 @@
 #include <stdio.h>
 #include <string.h>
 
-#define LINE_MAX_LENGTH 256 //每行最大字符数
 #define NAME_MAX_LENGTH 50 //每个参数名最大字符数
-#define VALUE_MAX_LENGTH 50 //每个参数值最大字符数
+#define VALUE_MAX_LENGTH 4096 //每个参数值最大字符数, 与文件路径参数的最大字符数相同
+#define LINE_MAX_LENGTH (NAME_MAX_LENGTH+VALUE_MAX_LENGTH+3) //每行最大字符数(含'='、换行符及结尾的'\0')
+#define INPUT_MAX_ITEMS 128 //参数表中最多的参数数
 
+// 参数表: 输入文件只读取一次, 之后各参数从表中查找
+// 定长数组, 由0号进程读取后只将实际的参数广播给各进程
+typedef struct InputTableStr{
 
-// 从输入文件中读取单独一个参数对应的值                                    
-// 参数：文件路径; 参数名称; 存储空间                        
-// 返回：0,未找到; 1,找到符合名称的值; 2,使用默认值                                     
-int getInputValue(const char *file_path, const char *para_name, char *buff);
+	int num;
+	char name[INPUT_MAX_ITEMS][NAME_MAX_LENGTH+1];
+	char value[INPUT_MAX_ITEMS][VALUE_MAX_LENGTH+1];
+	char used[INPUT_MAX_ITEMS]; // 参数是否被查找过, 从未查找的参数名无法识别
+
+}InputTable;
+
+// 读取输入文件中的所有参数并加入参数表, 同名参数以文件中第一次出现的为准
+// 返回：0,文件无法打开; 1,成功; -1,参数名或参数值超长, 或参数表已满
+int readInputFile(const char* file_path, InputTable* table);
+
+// 设置参数表中的一个参数, 已有同名参数时覆盖其值(用于命令行参数)
+// 返回：1,成功; 0,参数名或参数值超长, 或参数表已满
+int setInputValue(InputTable* table, const char* para_name, const char* value);
+
+// 从参数表中查找单独一个参数对应的值, 并将该参数标记为已查找
+// 参数：参数表; 参数名称; 存储空间(至少VALUE_MAX_LENGTH+1个字符)
+// 返回：0,未找到; 1,找到符合名称的值; 2,使用默认值
+int getInputValue(InputTable* table, const char *para_name, char *buff);
 
 #endif
@@ -2,6 +2,8 @@
 #include "mympi.h"
 #include "atom.h"
 
+#include <string.h>
+
 
 // 打印模拟时所需的各参数信息
 void printPara(FILE* f, Parameter* para){
@@ -9,9 +11,12 @@ void printPara(FILE* f, Parameter* para){
 	 if (! ifZeroRank())
       	return;
 
+   	int fromFile = strcmp(para->initFile, "none") != 0;
    	fprintf(f,
            "---输入参数:---\n\n"
            "势函数: %s\n"
+           "元素: %s (%s)\n"
+           "初始构型: %s%s%s\n"
            "X方向晶格数: %d      "
            "Y方向晶格数: %d      "
            "Z方向晶格数: %d\n"
@@ -22,8 +27,17 @@ void printPara(FILE* f, Parameter* para){
            //"printNums: %d\n"
            "步长: %g fs\n"
            "初始温度: %g K\n"
+           "力计算精度: %s\n"
+           "细胞重排方式: %s\n"
+           "细胞排列顺序: %s, 细胞内排序间隔: %d\n"
+           "原子数组内存页: %s\n"
            "----------------\n\n",
            para->potentialName,
+           para->elements,
+           para->speciesMode,
+           fromFile ? para->initFile : "面心立方晶格",
+           fromFile ? ", 格式 " : "",
+           fromFile ? para->initFormat : "",
            para->xLat, 
            para->yLat,
            para->zLat,
@@ -33,7 +47,12 @@ void printPara(FILE* f, Parameter* para){
            para->stepNums,
            //para->printNums,
            para->stepTime,
-           para->initTemper
+           para->initTemper,
+           para->mixedPrecision ? "混合精度" : "双精度",
+           para->rebinMode,
+           para->cellOrder,
+           para->sortInterval,
+           para->hugePages
     );
     fflush(f);
 
@@ -48,12 +67,54 @@ void printPotential(FILE* f, Potential* potential){
     fprintf(f, "---势函数信息:---\n\n");
     fprintf(f, "势函数   : %s\n", potential->potentialType);
     fprintf(f, "截断半径           : %g\n", potential->cutoff);
+    fprintf(f, "力计算函数         : %s\n", potential->kernelName);
+    fprintf(f, "边界作用力回传     : %s\n", potential->newton ? "是" : "否");
+    if (potential->respaSteps > 1)
+        fprintf(f, "多时间步(r-RESPA)  : 每 %d 步计算外层力, 内层截断 %g, 切换区间宽度 %g\n",
+            potential->respaSteps, potential->respaCutoff, potential->respaSwitch);
+    if (potential->eam)
+        fprintf(f, "EAM文件格式        : %s, %d 种元素\n",
+            potential->eam->format, potential->eam->elemNum);
+    else if (potential->tableNum){
+        double bytes = 0.0;
+        for (int i = 0; i < potential->tableNum; i++)
+            bytes += potTableBytes(potential->tables[i]);
+        fprintf(f, "插值表             : %s, %d 个区间, %d 张, 共 %g KB\n",
+            potential->tables[0]->cubic ? "三次插值" : "线性插值",
+            potential->tables[0]->n, potential->tableNum, bytes/1024.0);
+    }
+    else
+        fprintf(f, "插值表             : 无(解析形式)\n");
     //fprintf(f, "sigma          : %g\n", potential->sigma);
     //fprintf(f, "epsilon            : %g\n", potential->epsilon);
     //fprintf(f, "Beta            : %g\n", potential->Beta);
     fprintf(f, "----------------\n\n");
 }
 
+// 打印空间分解的进程网格及0号进程的细胞划分
+void printSpace(FILE* f, Spacial* space, Cell* cells){
+
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "---空间分解信息:---\n\n");
+    fprintf(f, "进程网格           : %d x %d x %d\n",
+        space->globalProcNum[0], space->globalProcNum[1], space->globalProcNum[2]);
+    const char* boundaryName[3];
+    for (int i = 0; i < 3; i++)
+        boundaryName[i] = space->periodic[i] ? "周期" : (space->shrinkWrap[i] ? "收缩包裹" : "固定");
+    fprintf(f, "边界条件           : x %s, y %s, z %s\n", boundaryName[0], boundaryName[1], boundaryName[2]);
+    fprintf(f, "每进程空间         : %g x %g x %g\n",
+        space->myLength[0], space->myLength[1], space->myLength[2]);
+    fprintf(f, "每进程细胞数       : %d x %d x %d\n",
+        cells->xyzCellNum[0], cells->xyzCellNum[1], cells->xyzCellNum[2]);
+    fprintf(f, "细胞划分           : 截断距离/%d, 邻居细胞 %d 个\n",
+        cells->haloDepth, cells->stencilNum);
+    fprintf(f, "作用力计算分块     : %d x %d x %d 个细胞\n",
+        cells->tileCellNum[0], cells->tileCellNum[1], cells->tileCellNum[2]);
+    fprintf(f, "----------------\n\n");
+}
+
 // 打印所模拟晶格的相关信息
 void printLattice(FILE* f, Lattice* lattice){
 
@@ -62,8 +123,8 @@ void printLattice(FILE* f, Lattice* lattice){
 
     fprintf(f, "---Lattice information:---\n\n");
     fprintf(f, "Lattice type    : %s\n", lattice->latticeType);
-    fprintf(f, "Atom name       : %s\n", lattice->atomName);
-    fprintf(f, "Atomic mass     : %g\n", lattice->atomM);
+    for (int t = 0; t < lattice->typeNum; t++)
+        fprintf(f, "Atom type %d     : %s, mass %g\n", t, lattice->atomName[t], lattice->atomM[t]);
     fprintf(f, "Lattice Constant: %g\n", lattice->latticeConst);
     fprintf(f, "----------------\n\n");
 }
@@ -73,15 +134,84 @@ void printTotalAtom(FILE* f, Atom* atoms){
     if (! ifZeroRank())
         return;
 
-    fprintf(f, "总原子数    : %d\n", atoms->totalNum);
+    fprintf(f, "总原子数    : %lld\n", (long long)atoms->totalNum);
 }
 
 // 输出体系的温度
-void printTemper(FILE*f, Energy* ener, int totalAtom){
+void printTemper(FILE*f, Energy* ener, bigint totalAtom){
     if (! ifZeroRank())
         return;
 
     double temper = (2*ener->kineticEnergy)/(totalAtom*kB*3);
 
     fprintf(f, "当前温度    : %g K\n", temper);
-}
\ No newline at end of file
+}
+
+// 输出体系每原子的势能与总能量
+void printEnergy(FILE*f, Energy* ener, bigint totalAtom){
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "每原子势能  : %.10g eV    每原子总能量: %.10g eV\n",
+        ener->potentialEnergy/totalAtom,
+        (ener->kineticEnergy + ener->potentialEnergy)/totalAtom);
+}
+
+// 输出越过固定边界而丢弃的原子累计数, 没有丢弃时不输出
+void printLost(FILE* f, bigint lostNum, bigint totalAtom){
+    if (! ifZeroRank() || lostNum == 0)
+        return;
+
+    fprintf(f, "丢弃原子数  : %lld (越过固定边界), 剩余 %lld\n", (long long)lostNum, (long long)totalAtom);
+}
+
+// 输出负载均衡前后的不均衡度(最大值与平均值之比)
+void printBalance(FILE* f, double timeImbalance, double atomBefore, double atomAfter){
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "负载均衡    : 作用力时间不均衡度 %.3f, 原子数不均衡度 %.3f -> %.3f\n",
+        timeImbalance, atomBefore, atomAfter);
+}
+
+// 打印每个原子平均占用的槽位数及内存
+void printMemory(FILE* f, const char* stage, double slotsPerAtom, double bytesPerAtom){
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "内存(%s)    : 每原子 %.2f 个槽位, %.1f 字节\n", stage, slotsPerAtom, bytesPerAtom);
+}
+
+// 输出收缩包裹边界外移后的体系范围
+void printBoxExpand(FILE* f, Spacial* space){
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "体系边界外移: x [%g, %g], y [%g, %g], z [%g, %g]\n",
+        space->globalMin[0], space->globalMax[0], space->globalMin[1], space->globalMax[1],
+        space->globalMin[2], space->globalMax[2]);
+}
+
+// 打印处理器拓扑概况及各进程的绑定结果
+void printAffinity(FILE* f, Spacial* space, const int* counts, const int* map){
+    if (! ifZeroRank())
+        return;
+
+    fprintf(f, "---进程绑定:---\n\n");
+    fprintf(f, "处理器拓扑         : %d 个插槽, %d 个末级缓存, %d 个物理核, %d 个逻辑处理器\n",
+        counts[3], counts[2], counts[1], counts[0]);
+    if (getRankNums() > counts[1])
+        fprintf(f, "进程数 %d 超过物理核数, 使用超线程或多个进程共用处理器\n", getRankNums());
+
+    int* p = space->globalProcNum;
+    for (int r = 0; r < getRankNums(); r++){
+        const int* m = map + 6*r;
+        fprintf(f, "进程 %4d (%d,%d,%d) -> ", r, r%p[0], (r/p[0])%p[1], r/(p[0]*p[1]));
+        if (m[0] < 0)
+            fprintf(f, "无可用处理器\n");
+        else
+            fprintf(f, "CPU %d (插槽 %d, 末级缓存 %d, 核 %d, 超线程 %d)%s\n",
+                m[0], m[1], m[2], m[3], m[4], m[5] ? "" : " 绑定失败");
+    }
+    fprintf(f, "----------------\n\n");
+}
@@ -9,6 +9,8 @@
 #include "lattice.h"
 #include "atom.h"
 #include "energy.h"
+#include "space.h"
+#include "cell.h"
 
 #include <stdio.h>
 
@@ -18,6 +20,9 @@ void printPara(FILE* f, Parameter* para);
 // 打印势函数的相关信息
 void printPotential(FILE* f, Potential* potential);
 
+// 打印空间分解的进程网格及0号进程的细胞划分
+void printSpace(FILE* f, Spacial* space, Cell* cells);
+
 // 打印所模拟晶格的相关信息
 void printLattice(FILE* f, Lattice* lattice);
 
@@ -25,5 +30,24 @@ void printLattice(FILE* f, Lattice* lattice);
 void printTotalAtom(FILE* f, Atom* atoms);
 
 // 输出体系的温度
-void printTemper(FILE*f, Energy* ener, int totalAtom);
+void printTemper(FILE*f, Energy* ener, bigint totalAtom);
+
+// 输出体系每原子的势能与总能量
+void printEnergy(FILE*f, Energy* ener, bigint totalAtom);
+
+// 输出越过固定边界而丢弃的原子累计数, 没有丢弃时不输出
+void printLost(FILE* f, bigint lostNum, bigint totalAtom);
+
+// 输出负载均衡前后的不均衡度(最大值与平均值之比)
+void printBalance(FILE* f, double timeImbalance, double atomBefore, double atomAfter);
+
+// 打印每个原子平均占用的槽位数及内存
+void printMemory(FILE* f, const char* stage, double slotsPerAtom, double bytesPerAtom);
+
+// 输出收缩包裹边界外移后的体系范围
+void printBoxExpand(FILE* f, Spacial* space);
+
+// 打印处理器拓扑概况及各进程的绑定结果
+// counts为逻辑处理器、物理核、末级缓存及插槽数, map为各进程的处理器、插槽、末级缓存、核、超线程序号及是否绑定成功
+void printAffinity(FILE* f, Spacial* space, const int* counts, const int* map);
 #endif
\ No newline at end of file
@@ -1,16 +1,103 @@
 #include "lattice.h"
+#include "parameter.h"
+#include "random.h"
+#include "error.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+// 已知元素的参数: 名称, 相对原子质量, FCC晶格常数, LJ参数σ, ε
+typedef struct ElementStr{
+
+	const char* name;
+	double mass;
+	double latticeConst;
+	double sigma;
+	double epsilon;
+
+}Element;
+
+static const Element elementTable[] = {
+	{"Cu",  63.55, 3.615, 2.315, 0.167},
+	{"Ag", 107.87, 4.086, 2.644, 0.345},
+	{"Ni",  58.69, 3.524, 2.282, 0.520},
+	{"Au", 196.97, 4.078, 2.637, 0.458},
+	{"Al",  26.98, 4.050, 2.620, 0.392},
+};
+
 // 初始化晶格结构体
-void initLatticeInfo(Lattice** lat){
+void initLatticeInfo(Lattice** lat, struct ParameterStr* para){
 
 	*lat = (Lattice*)malloc(sizeof(Lattice));
 	Lattice* lattice = *lat;
 
 	strcpy(lattice->latticeType, "FCC");
-	strcpy(lattice->atomName, "Cu");
-	lattice->atomM = 63.55;
-	lattice->latticeConst = 3.615;
-}
\ No newline at end of file
+	strcpy(lattice->speciesMode, para->speciesMode);
+	lattice->substituteFraction = para->substituteFraction;
+	if (strcmp(lattice->speciesMode, "basis") != 0 && strcmp(lattice->speciesMode, "random") != 0){
+		errorInfo(speciesMode);
+		exit(speciesMode);
+	}
+
+	// 解析以逗号分隔的元素列表
+	char list[128];
+	strcpy(list, para->elements);
+	lattice->typeNum = 0;
+	double latticeConst[MAXTYPES];
+	for (char* name = strtok(list, ", \t"); name != NULL; name = strtok(NULL, ", \t")){
+
+		const Element* elem = NULL;
+		for (int i = 0; i < (int)(sizeof(elementTable)/sizeof(Element)); i++)
+			if (strcmp(name, elementTable[i].name) == 0)
+				elem = &elementTable[i];
+		if (elem == NULL || lattice->typeNum == MAXTYPES){
+			errorInfo(elemName);
+			exit(elemName);
+		}
+
+		int t = lattice->typeNum++;
+		strcpy(lattice->atomName[t], elem->name);
+		lattice->atomM[t] = elem->mass;
+		lattice->invM[t] = 1.0/elem->mass;
+		lattice->sigma[t] = elem->sigma;
+		lattice->epsilon[t] = elem->epsilon;
+		latticeConst[t] = elem->latticeConst;
+	}
+	if (lattice->typeNum == 0){
+		errorInfo(elemName);
+		exit(elemName);
+	}
+
+	// 各元素所占比例
+	double fraction[MAXTYPES] = {0.0};
+	if (strcmp(lattice->speciesMode, "basis") == 0)
+		for (int ib = 0; ib < 4; ib++)
+			fraction[ib % lattice->typeNum] += 0.25;
+	else{
+		fraction[0] = lattice->typeNum > 1 ? 1.0 - lattice->substituteFraction : 1.0;
+		for (int t = 1; t < lattice->typeNum; t++)
+			fraction[t] = lattice->substituteFraction/(lattice->typeNum - 1);
+	}
+
+	// 合金的晶格常数按Vegard定律取各元素晶格常数的加权平均
+	lattice->latticeConst = 0.0;
+	for (int t = 0; t < lattice->typeNum; t++)
+		lattice->latticeConst += fraction[t]*latticeConst[t];
+}
+
+// 原子所在晶格位置的类型, ib为晶胞内基元的序号, id为原子id
+// basis方式下第ib个基元位置为第(ib % 元素种数)种元素;
+// random方式下以substituteFraction的概率替换为第一种以外的元素, 随机数只由原子id决定, 与进程划分无关
+int siteType(Lattice* lattice, int ib, bigint id){
+
+	if (lattice->typeNum == 1)
+		return 0;
+
+	if (strcmp(lattice->speciesMode, "basis") == 0)
+		return ib % lattice->typeNum;
+
+	if (uniformAt(id, 457, 0) >= lattice->substituteFraction)
+		return 0;
+	int t = 1 + (int)(uniformAt(id, 457, 1)*(lattice->typeNum - 1));
+	return t < lattice->typeNum ? t : lattice->typeNum - 1;
+}
@@ -4,18 +4,35 @@
 #ifndef LATTICE_H_
 #define LATTICE_H_
 
+#include "mytype.h"
+
+#define MAXTYPES 8 // 元素种数的最大值
+
+struct ParameterStr;
+
 // 晶格结构体
 typedef struct LatticeStr{
 	
 	char latticeType[10]; // 晶格类型
-	char atomName[4];	   // 原子名称
-	double atomM;  			// 元素的相对原子质量
+
+	int typeNum;                // 元素种数, 原子类型即元素在列表中的下标
+	char atomName[MAXTYPES][4];	// 各元素名称
+	double atomM[MAXTYPES];  	// 各元素的相对原子质量
+	double invM[MAXTYPES];      // 各元素质量的倒数, 积分时以乘法代替除法
+	double sigma[MAXTYPES];     // 各元素的LJ参数σ(Angstrom)
+	double epsilon[MAXTYPES];   // 各元素的LJ参数ε(eV)
+
+	char speciesMode[16];       // 元素分布方式: basis 按晶胞内基元位置, random 随机替换
+	double substituteFraction;  // random方式下被其他元素替换的比例
 
    	double latticeConst;   // 晶格常数
  	
 }Lattice;
 
 // 初始化晶格结构体
-void initLatticeInfo(Lattice** lat);
+void initLatticeInfo(Lattice** lat, struct ParameterStr* para);
+
+// 原子所在晶格位置的类型, ib为晶胞内基元的序号, id为原子id
+int siteType(Lattice* lattice, int ib, bigint id);
 
 #endif
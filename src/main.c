@@ -5,13 +5,16 @@
 #include "atom.h"
 #include "potential.h"
 #include "system.h"
+#include "balance.h"
 
 #include <stdio.h>
 #include <unistd.h>
+#include <float.h>
 #include <mpi.h>
 
-void updateMomenta(System* sys, Parameter* para); 
-void updatePosition(System* sys, Parameter* para);
+void kickDrift(System* sys, double kick, double drift);
+double kickMomenta(System* sys, double kick);
+void kickSlow(System* sys, double kick);
 
 int main(int argc, char** argv){
 	
@@ -31,39 +34,60 @@ int main(int argc, char** argv){
 
 	beginTimer(total);
 
-	Parameter* para = readParameter();
+	Parameter* para = readParameter(argc, argv);
 	printPara(stdout,para);
 
 	beginTimer(loop);
 	//sleep(5);
 	System* sys = initSystem(para);
 
-	int smBufSize = sys->datacomm->smsize*MAXPERCELL*sizeof(AtomData);
-
-	//printf("size: %d\n",sys->datacomm->bufSize );
-	MPI_Win_allocate_shared(smBufSize+6*sizeof(int), sizeof(char),
-          MPI_INFO_NULL,MPI_COMM_WORLD, &sys->smBuf, &sys->win1);
-	MPI_Win_allocate_shared(sys->datacomm->bufSize+2*sizeof(int), sizeof(char),
-          MPI_INFO_NULL,MPI_COMM_WORLD, &sys->usrBuf, &sys->win2);
-
 	adjustAtoms(sys);
 	computeForce(sys);
-
+	computeTotalKinetic(sys);
+	computeTotalPotential(sys);
+	sampleEnergyDrift(sys->energy, 0.0);
+
+	// 速度Verlet积分: 每步末尾的半步动量更新推迟到下一步, 与下一步的半步动量更新及位置更新合为一遍;
+	// 只在需要输出能量的步及最后一步单独完成末尾的半步动量更新, 同时求得动能
+	// 多时间步(r-RESPA)积分时外层力只在每个外层步的首尾更新动量, 末尾的更新同样推迟到下一外层步;
+	// 只有外层步结束时才有完整的势能, 能量输出在printNums与respaSteps的公倍数步进行
+	double dt = para->stepTime;
+	int respa = sys->potential->respaSteps;
+	int pending = 0;      // 上一步末尾的半步动量更新是否尚未完成
+	int pendingSlow = 0;  // 上一外层步末尾的外层力动量更新是否尚未完成
 	for(int i=1;i<=para->stepNums;i++){
-    	updateMomenta(sys, para); 
-
-    	updatePosition(sys, para);
+    	if (respa > 1 && (i-1)%respa == 0)
+    		kickSlow(sys, (pendingSlow ? 1.0 : 0.5)*respa*dt);
+    	kickDrift(sys, pending ? dt : 0.5*dt, dt);
 
     	//beginTimer(adjustatom);
-    	adjustAtoms(sys);
+    	// 负载均衡或收缩包裹边界外移时重建空间划分, 同时完成原子的迁移和通信
+    	// 边界只在上次原子交换发现有原子越出时外移, 通常不需要额外的集合通信
+    	if(para->balanceInterval > 0 && i%para->balanceInterval == 0)
+    		balanceSpace(sys);
+    	else if (! expandBox(sys))
+    		adjustAtoms(sys);
     	//endTimer(adjustatom);
 
     	beginTimer(force);
-    	computeForce(sys);
+    	if (respa > 1)
+    		computeForceRespa(sys, i%respa == 0);
+    	else
+    		computeForce(sys);
     	endTimer(force);
 
-    	updateMomenta(sys, para); 
-    	if(i%para->printNums == 0){
+    	pending = 1;
+    	pendingSlow = respa > 1 && i%respa == 0;
+    	int printStep = i%para->printNums == 0 && i%respa == 0;
+    	if(printStep || i == para->stepNums){
+    		if (pendingSlow)
+    			kickSlow(sys, 0.5*respa*dt);
+    		sumTotalKinetic(sys->energy, kickMomenta(sys, 0.5*dt));
+    		pending = 0;
+    		pendingSlow = 0;
+    	}
+
+    	if(printStep){
 
     	//MPI_Allreduce(&sys->atoms->myNum, &sys->atoms->totalNum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
     	//printTotalAtom(stdout,sys->atoms);
@@ -71,14 +95,16 @@ int main(int argc, char** argv){
 			{
 				printf("当前步数: %d 		",i);
 			}		
-    		computeTotalKinetic(sys);	
+    		computeTotalPotential(sys);
+    		sampleEnergyDrift(sys->energy, i*para->stepTime);
     		printTemper(stdout,sys->energy,sys->atoms->totalNum);
+    		printEnergy(stdout,sys->energy,sys->atoms->totalNum);
+    		printLost(stdout,sys->lostNum,sys->atoms->totalNum);
     	}
     }
 	endTimer(loop);
 	
-	MPI_Win_free(&sys->win1);
-	MPI_Win_free(&sys->win2);
+	freeCommWindows(sys);
 
 	endTimer(total);
 
@@ -99,28 +125,68 @@ int main(int argc, char** argv){
 		fprintf(stdout, "通信时间: %g 平均: %g\n",globalcomm,globalcomm/getRankNums());
 		fprintf(stdout, "计算力时间: %g 平均: %g\n------\n",globalforce,globalforce/getRankNums());
 		fprintf(stdout, "test time: %g\n",getGlobalTime(test));
+		fprintf(stdout, "吞吐量: %g 原子步/秒\n",
+			(double)sys->atoms->totalNum*para->stepNums/(globalloop/getRankNums()));
 	}
+	printEnergyDrift(stdout, sys->energy, sys->atoms->totalNum);
+	reportMemory(sys, "结束时");
 
 	MPI_Finalize();
 	return 0;
 }
 
-void updateMomenta(System* sys, Parameter* para){
-
-	double t = 0.5*para->stepTime;
+// 动量更新kick时间后再将位置更新drift时间, 本空间原子只遍历一遍
+// 同时记录本空间原子坐标的范围, 供原子交换时判断是否有原子越出收缩包裹边界
+void kickDrift(System* sys, double kick, double drift){
+
+	double* invM = sys->lattice->invM;
+	double3 lo = {DBL_MAX, DBL_MAX, DBL_MAX};
+	double3 hi = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+
+	for (int k=0; k<sys->cells->activeNum; k++)
+      	for (int nCell=sys->cells->active[k],n=sys->cells->cellStart[nCell],count=0; count<sys->cells->atomNum[nCell]; count++,n++)
+      	{
+      		double t = drift*invM[sys->atoms->type[n]];
+      		for(int i=0;i<3;i++){
+         		sys->atoms->momenta[n][i] += kick*sys->atoms->force[n][i];
+         		sys->atoms->pos[n][i] += t*sys->atoms->momenta[n][i];
+         		lo[i] = sys->atoms->pos[n][i] < lo[i] ? sys->atoms->pos[n][i] : lo[i];
+         		hi[i] = sys->atoms->pos[n][i] > hi[i] ? sys->atoms->pos[n][i] : hi[i];
+         	}
+      	}
+
+	for(int i=0;i<3;i++){
+		sys->atomMin[i] = lo[i];
+		sys->atomMax[i] = hi[i];
+	}
+}
 
-	for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-      	for (int n=MAXPERCELL*nCell,count=0; count<sys->cells->atomNum[nCell]; count++,n++)
-      		for(int i=0;i<3;i++)
-         		sys->atoms->momenta[n][i] += t*sys->atoms->force[n][i];
+// 动量更新kick时间, 返回更新后本空间原子的总动能
+double kickMomenta(System* sys, double kick){
+
+	double* invM = sys->lattice->invM;
+	double kinetic = 0.0;
+
+	for (int k=0; k<sys->cells->activeNum; k++)
+      	for (int nCell=sys->cells->active[k],n=sys->cells->cellStart[nCell],count=0; count<sys->cells->atomNum[nCell]; count++,n++)
+      	{
+      		double p2 = 0.0;
+      		for(int i=0;i<3;i++){
+         		sys->atoms->momenta[n][i] += kick*sys->atoms->force[n][i];
+         		p2 += sys->atoms->momenta[n][i]*sys->atoms->momenta[n][i];
+         	}
+         	kinetic += 0.5*p2*invM[sys->atoms->type[n]];
+      	}
+	return kinetic;
 }
-void updatePosition(System* sys, Parameter* para){
 
-	double t = para->stepTime;
-	double m = sys->lattice->atomM;
+// 以外层力更新动量kick时间
+void kickSlow(System* sys, double kick){
+
+	double3* slow = sys->potential->slowForce;
 
-	for (int nCell=0; nCell<sys->cells->myCellNum; nCell++)
-      	for (int n=MAXPERCELL*nCell,count=0; count<sys->cells->atomNum[nCell]; count++,n++)
+	for (int k=0; k<sys->cells->activeNum; k++)
+      	for (int nCell=sys->cells->active[k],n=sys->cells->cellStart[nCell],count=0; count<sys->cells->atomNum[nCell]; count++,n++)
       		for(int i=0;i<3;i++)
-         		sys->atoms->pos[n][i] += t*sys->atoms->momenta[n][i]/m;
-}
\ No newline at end of file
+         		sys->atoms->momenta[n][i] += kick*slow[n][i];
+}
@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include "memory.h"
+#include "mympi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+// 每块内存之前的头部, 记录释放时所需的信息, 大小为64字节以保持数据的对齐
+typedef struct BlockHeaderStr{
+
+	void* base;     // 分配所得的起始地址
+	size_t length;  // 映射的长度, 为0表示由malloc分配
+	char pad[64 - sizeof(void*) - sizeof(size_t)];
+
+}BlockHeader;
+
+static enum PageMode pageMode = smallPages;
+
+// 设置之后分配的大块内存所用的页, name为none, thp或hugetlb, 无法识别时返回0
+int setPageMode(const char* name){
+
+	if (strcmp(name, "none") == 0)
+		pageMode = smallPages;
+	else if (strcmp(name, "thp") == 0)
+		pageMode = transparentHuge;
+	else if (strcmp(name, "hugetlb") == 0)
+		pageMode = hugetlbPages;
+	else
+		return 0;
+	return 1;
+}
+
+// 当前所用的页
+enum PageMode getPageMode(){
+
+	return pageMode;
+}
+
+// 以匿名映射分配length字节(大页的整数倍), 成功时返回映射的起始地址, 否则返回NULL
+static void* mapPages(size_t length, int hugetlb){
+
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+	if (hugetlb)
+		flags |= MAP_HUGETLB;
+#else
+	if (hugetlb)
+		return NULL;
+#endif
+	void* p = mmap(NULL, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+// 分配bytes字节的大块内存, 起始地址按64字节对齐; 不足一个大页时总是使用普通页
+void* allocBlock(size_t bytes){
+
+	size_t total = bytes + sizeof(BlockHeader);
+	BlockHeader* head = NULL;
+
+	if (pageMode != smallPages && total >= HUGEPAGE_SIZE){
+
+		size_t length = (total + HUGEPAGE_SIZE - 1)/HUGEPAGE_SIZE*HUGEPAGE_SIZE;
+		void* base = NULL;
+
+		if (pageMode == hugetlbPages){
+			base = mapPages(length, 1);
+			// 预留的大页不足, 之后的分配均改用透明大页
+			if (base == NULL){
+				if (ifZeroRank())
+					fprintf(stdout, "hugetlbfs大页不足, 改用透明大页\n");
+				pageMode = transparentHuge;
+			}
+		}
+
+		// 透明大页: 多映射一个大页, 从其中按大页对齐的地址开始使用
+		size_t mapped = length;
+		char* start = base;
+		if (base == NULL){
+			mapped = length + HUGEPAGE_SIZE;
+			base = mapPages(mapped, 0);
+			if (base != NULL){
+				start = (char*)(((uintptr_t)base + HUGEPAGE_SIZE - 1)/HUGEPAGE_SIZE*HUGEPAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+				madvise(start, length, MADV_HUGEPAGE);
+#endif
+			}
+		}
+
+		if (base != NULL){
+			head = (BlockHeader*)start;
+			head->base = base;
+			head->length = mapped;
+			return head + 1;
+		}
+	}
+
+	void* base = NULL;
+	if (posix_memalign(&base, sizeof(BlockHeader), total) != 0)
+		return NULL;
+	head = (BlockHeader*)base;
+	head->base = base;
+	head->length = 0;
+	return head + 1;
+}
+
+// 释放allocBlock分配的内存, p可为NULL
+void freeBlock(void* p){
+
+	if (! p)
+		return;
+	BlockHeader* head = (BlockHeader*)p - 1;
+	if (head->length)
+		munmap(head->base, head->length);
+	else
+		free(head->base);
+}
+
+// 分配共享内存窗口时的提示: 各进程的部分分别按页对齐分配(alloc_shared_noncontig),
+// 由各进程首次写入自己的部分, 不必与其他进程的部分连续
+MPI_Info sharedWinInfo(){
+
+	static MPI_Info info = MPI_INFO_NULL;
+	if (info == MPI_INFO_NULL){
+		MPI_Info_create(&info);
+		MPI_Info_set(info, "alloc_shared_noncontig", "true");
+	}
+	return info;
+}
@@ -0,0 +1,37 @@
+// memory.h
+// 原子数组等按槽位分配的大块内存: 可选用透明大页或hugetlbfs大页以减少TLB缺失,
+// 各进程分配后由自己首次写入, 使内存页落在该进程所在的NUMA节点上
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stddef.h>
+#include <mpi.h>
+
+// 大页的大小
+#define HUGEPAGE_SIZE (2*1024*1024)
+
+// 大块内存所用的页
+enum PageMode{
+	smallPages,      // 普通页(malloc)
+	transparentHuge, // 按大页对齐并以madvise(MADV_HUGEPAGE)请求透明大页
+	hugetlbPages     // 从hugetlbfs预留的大页中分配, 预留不足时退回透明大页
+};
+
+// 设置之后分配的大块内存所用的页, name为none, thp或hugetlb, 无法识别时返回0
+int setPageMode(const char* name);
+
+// 当前所用的页
+enum PageMode getPageMode();
+
+// 分配bytes字节的大块内存, 起始地址按64字节对齐; 不足一个大页时总是使用普通页
+void* allocBlock(size_t bytes);
+
+// 释放allocBlock分配的内存, p可为NULL
+void freeBlock(void* p);
+
+// 分配共享内存窗口时的提示: 各进程的部分分别按页对齐分配(alloc_shared_noncontig),
+// 由各进程首次写入自己的部分, 不必与其他进程的部分连续
+MPI_Info sharedWinInfo();
+
+#endif
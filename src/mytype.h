@@ -4,7 +4,10 @@
 #ifndef MYTYPE_H_
 #define MYTYPE_H_
 
+#include <stdint.h>
+
 typedef double double3[3]; // 坐标类型
 typedef int int3[3]; 
+typedef int64_t bigint;    // 原子id及整个体系的原子数, 超过2^31个原子时不溢出; 本进程内的原子数及槽位仍用int
 
 #endif  
\ No newline at end of file
@@ -0,0 +1,80 @@
+// pairkernel.h
+// 对势作用力计算的循环模板, 由potential.c多次包含, 为每种势函数生成各自的力计算函数,
+// 使对势的求值在最内层循环中内联展开, 而不是每对原子通过函数指针调用一次
+// 每次包含前需定义:
+//   PAIR_KERNEL_NAME            生成的函数名
+//   PAIR_EVAL(pot, ij, r2, e, fr)   由类型对下标ij及r²求势能e(已减去截断处的值)及(dE/dr)/r
+// 两个原子均在本空间时，势能各分一半；另一原子在通信区域时，本原子只取一半，另一半由邻居进程计算
+// 启用跨边界的作用力回传(pot.newton)时，与通信区域细胞的原子对只在细胞偏移为正的一侧计算
+// (对侧进程看到的偏移符号相反)，另一原子所得的力和势能由reverseGhostForce传回其属主
+// 本文件不设包含保护
+
+static void PAIR_KERNEL_NAME(struct SystemStr* sys){
+
+	// 复制一份势函数参数, 避免与作用力数组的写入发生别名, 使参数可被提出循环
+	const Potential pot = *sys->potential;
+   double rCut2 = pot.cutoff*pot.cutoff;
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+   	for (int k1 = 0; k1<cells->activeNum; k1++)
+   	{
+      	int cell1 = cells->active[k1];
+      	int atomnum1 = cells->atomNum[cell1];
+      	if ( atomnum1 == 0 ) 
+      		continue;
+
+      	int pad1 = cells->cellToPad[cell1];
+
+   		// 只遍历与截断球相交的邻居细胞
+   		for (int s = 0; s < cells->stencilNum; s++)
+   				{
+   					int cell2 = cells->padToCell[pad1 + cells->stencil[s]];
+	
+   					int atomnum2 = cells->atomNum[cell2];
+   					if ( atomnum2 == 0 ) 
+      					continue;
+
+   					// 防止重复计算: 与通信区域细胞的原子对按偏移选出一侧, 本空间细胞之间按槽位先后去重
+   					int ownCell2 = cell2 < cells->myCellNum;
+   					if (! ownCell2 && pot.newton && cells->stencil[s] < 0)
+   						continue;
+   					int first2 = cells->cellStart[cell2];
+   					int end2 = first2 + atomnum2;
+
+      				for (int n1=cells->cellStart[cell1],count1=0; count1<atomnum1; count1++,n1++)
+         			{
+         				int it1 = atoms->type[n1]*pot.typeNum;
+         				int start2 = ownCell2 && n1 >= first2 ? n1+1 : first2;
+         				
+         				for (int n2=start2; n2<end2; n2++)
+            			{
+                  			double3 r_vector;
+           					double r2 = 0.0;
+                  			for (int i=0; i<3; i++)
+               				{ 
+                  				r_vector[i] = atoms->pos[n1][i]-atoms->pos[n2][i];
+                  				r2 += r_vector[i]*r_vector[i];
+               				}
+
+               				if ( r2 > rCut2 )
+               					continue;
+
+               				double e, fr;
+               				PAIR_EVAL(&pot, it1 + atoms->type[n2], r2, &e, &fr);
+              				for (int m=0; m<3; m++)
+               				{
+                  				atoms->force[n1][m] -= r_vector[m]*fr;
+                  				atoms->force[n2][m] += r_vector[m]*fr;
+               				}
+               				atoms->pot[n1] += 0.5*e;
+               				atoms->pot[n2] += 0.5*e;
+   						}  
+            		}
+         		}
+    }
+}
+
+#undef PAIR_KERNEL_NAME
+#undef PAIR_EVAL
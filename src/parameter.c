@@ -1,63 +1,270 @@
 #include "parameter.h"
 #include "getinput.h"
+#include "mympi.h"
+#include "error.h"
 
 #include <stdlib.h>
+#include <mpi.h>
 
-// 从文件中解析出各参数
-Parameter* readParameter(){
+// 将0号进程的参数表广播给各进程: 只传递实际的参数, 依次存放为"参数名\0参数值\0",
+// 而不是整个定长的参数表, 各进程再按顺序加入自己的参数表
+static void broadcastInputTable(InputTable* table){
+
+	int size = 0;
+	if (ifZeroRank())
+		for (int i = 0; i < table->num; i++)
+			size += strlen(table->name[i]) + strlen(table->value[i]) + 2;
+	MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	char* buf = (char*)malloc(size > 0 ? size : 1);
+	if (ifZeroRank()){
+		char* p = buf;
+		for (int i = 0; i < table->num; i++){
+			strcpy(p, table->name[i]);
+			p += strlen(p) + 1;
+			strcpy(p, table->value[i]);
+			p += strlen(p) + 1;
+		}
+	}
+	MPI_Bcast(buf, size, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+	if (! ifZeroRank())
+		for (char* p = buf; p < buf + size; ){
+			char* name = p;
+			p += strlen(p) + 1;
+			setInputValue(table, name, p);
+			p += strlen(p) + 1;
+		}
+	free(buf);
+}
+
+// 由0号进程读取输入文件并以命令行参数覆盖, 再将参数表广播给各进程
+// 命令行参数为 --name=value, 其中 --input=path 指定输入文件(默认为INPUTFILE_PATH)
+// 默认的输入文件不存在时全部使用默认值; 指定的输入文件无法读取或参数超长时报错退出
+static void buildInputTable(int argc, char** argv, InputTable* table){
+
+	memset(table, 0, sizeof(InputTable));
+	int status = 1;
+	if (ifZeroRank()){
+
+		const char* path = NULL;
+		for (int i = 1; i < argc; i++)
+			if (strncmp(argv[i], "--input=", 8) == 0)
+				path = argv[i] + 8;
+		int read = readInputFile(path ? path : INPUTFILE_PATH, table);
+		if (read < 0 || (read == 0 && path))
+			status = 0;
+
+		for (int i = 1; i < argc; i++){
+			char* sign = strchr(argv[i], '=');
+			int len = sign ? (int)(sign - argv[i]) - 2 : 0;
+			if (strncmp(argv[i], "--", 2) != 0 || len <= 0){
+				fprintf(stdout, "忽略无法识别的命令行参数: %s\n", argv[i]);
+				continue;
+			}
+			if (strncmp(argv[i], "--input=", 8) == 0)
+				continue;
+			if (len > NAME_MAX_LENGTH){
+				fprintf(stdout, "无法识别的参数: %s\n", argv[i]);
+				status = 0;
+				continue;
+			}
+
+			char name[NAME_MAX_LENGTH+1];
+			memcpy(name, argv[i] + 2, len);
+			name[len] = '\0';
+			if (! setInputValue(table, name, sign + 1))
+				status = 0;
+		}
+	}
+	MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (! status){
+		errorInfo(inputFile);
+		exit(inputFile);
+	}
+	broadcastInputTable(table);
+}
+
+// 参数表中从未被查找的参数名无法识别(如拼写错误), 报错退出
+static void checkInputNames(const InputTable* table){
+
+	int unknown = 0;
+	for (int i = 0; i < table->num; i++)
+		if (! table->used[i]){
+			if (ifZeroRank())
+				fprintf(stdout, "无法识别的参数: %s\n", table->name[i]);
+			unknown++;
+		}
+	if (unknown){
+		errorInfo(inputName);
+		exit(inputName);
+	}
+}
+
+// 将字符串参数复制到定长的参数字段中, 超长时报错退出而不截断
+static void copyString(char* field, size_t size, const char* name, const char* value){
+
+	if (snprintf(field, size, "%s", value) < (int)size)
+		return;
+	if (ifZeroRank())
+		fprintf(stdout, "参数值过长(最多%d个字符): %s\n", (int)size-1, name);
+	errorInfo(paraLength);
+	exit(paraLength);
+}
+
+// 从文件及命令行参数中解析出各参数, 所有进程一同调用
+Parameter* readParameter(int argc, char** argv){
 
 	Parameter* para = (Parameter*)malloc(sizeof(Parameter));
 
 	// 初始化参数结构体（默认值）
 	memset(para->potentialName, 0, 128);
-	strcpy(para->potentialName, "Morse");
+	strcpy(para->potentialName, "LJ");
 	para->xLat = 10;
 	para->yLat = 10;
 	para->zLat = 10;
-	para->xProc = 2;
-	para->yProc = 2;
-	para->zProc = 2;
+	para->xProc = 0;	// 0表示自动选择
+	para->yProc = 0;
+	para->zProc = 0;
 	para->stepNums = 100;
 	para->printNums = 10;
 	para->stepTime = 1.0;
 	para->initTemper = 600.0;
+	para->mixedPrecision = 0;
+	strcpy(para->interpolation, "none");
+	para->tablePoints = 2000;
+	memset(para->potentialFile, 0, sizeof(para->potentialFile));
+	memset(para->elements, 0, 128);
+	strcpy(para->elements, "Cu");
+	strcpy(para->speciesMode, "basis");
+	para->substituteFraction = 0.5;
+	para->balanceInterval = 0;
+	para->cellDivision = 1;
+	strcpy(para->rebinMode, "move");
+	strcpy(para->cellOrder, "xyz");
+	para->sortInterval = 0;
+	para->tileSize = 0;
+	strcpy(para->forceEngine, "cell");
+	para->newton = 0;
+	para->respaSteps = 1;
+	para->respaCutoff = 0.0;
+	para->respaSwitch = 0.0;
+	strcpy(para->boundary, "ppp");
+	strcpy(para->hugePages, "none");
+	strcpy(para->affinity, "none");
+	strcpy(para->initFile, "none");
+	strcpy(para->initFormat, "xyz");
 
 	//可改进：参数值的格式检查-----------------
 
 	// 从文件中获取参数，当没有对应的参数或指定使用默认值时，使用默认参数值
-	char value_buff[VALUE_MAX_LENGTH];
-	if(getInputValue(INPUTFILE_PATH, "potentialName", value_buff) == 1)
-		strcpy(para->potentialName, value_buff);
+	InputTable* table = (InputTable*)malloc(sizeof(InputTable));
+	buildInputTable(argc, argv, table);
+	char value_buff[VALUE_MAX_LENGTH+1];
+	if(getInputValue(table, "potentialName", value_buff) == 1)
+		copyString(para->potentialName, sizeof(para->potentialName), "potentialName", value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "xLatticeNum", value_buff) == 1)
+	if(getInputValue(table, "xLatticeNum", value_buff) == 1)
 		para->xLat = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "yLatticeNum", value_buff) == 1)
+	if(getInputValue(table, "yLatticeNum", value_buff) == 1)
 		para->yLat = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "zLatticeNum", value_buff) == 1)
+	if(getInputValue(table, "zLatticeNum", value_buff) == 1)
 		para->zLat = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "xProcessNum", value_buff) == 1)
+	if(getInputValue(table, "xProcessNum", value_buff) == 1)
 		para->xProc = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "yProcessNum", value_buff) == 1)
+	if(getInputValue(table, "yProcessNum", value_buff) == 1)
 		para->yProc = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "zProcessNum", value_buff) == 1)
+	if(getInputValue(table, "zProcessNum", value_buff) == 1)
 		para->zProc = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "stepNums", value_buff) == 1)
+	if(getInputValue(table, "stepNums", value_buff) == 1)
 		para->stepNums = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "printNums", value_buff) == 1)
+	if(getInputValue(table, "printNums", value_buff) == 1)
 		para->printNums = atoi(value_buff);
 
-	if(getInputValue(INPUTFILE_PATH, "stepTime", value_buff) == 1)
+	if(getInputValue(table, "stepTime", value_buff) == 1)
 		para->stepTime = strtod(value_buff, NULL);
 
-	if(getInputValue(INPUTFILE_PATH, "initialTemperature", value_buff) == 1)
+	if(getInputValue(table, "initialTemperature", value_buff) == 1)
 		para->initTemper = strtod(value_buff, NULL);
 
+	if(getInputValue(table, "mixedPrecision", value_buff) == 1)
+		para->mixedPrecision = atoi(value_buff);
+
+	if(getInputValue(table, "interpolation", value_buff) == 1)
+		copyString(para->interpolation, sizeof(para->interpolation), "interpolation", value_buff);
+
+	if(getInputValue(table, "tablePoints", value_buff) == 1)
+		para->tablePoints = atoi(value_buff);
+
+	if(getInputValue(table, "potentialFile", value_buff) == 1)
+		copyString(para->potentialFile, sizeof(para->potentialFile), "potentialFile", value_buff);
+
+	if(getInputValue(table, "elements", value_buff) == 1)
+		copyString(para->elements, sizeof(para->elements), "elements", value_buff);
+
+	if(getInputValue(table, "speciesMode", value_buff) == 1)
+		copyString(para->speciesMode, sizeof(para->speciesMode), "speciesMode", value_buff);
+
+	if(getInputValue(table, "substituteFraction", value_buff) == 1)
+		para->substituteFraction = strtod(value_buff, NULL);
+
+	if(getInputValue(table, "balanceInterval", value_buff) == 1)
+		para->balanceInterval = atoi(value_buff);
+
+	if(getInputValue(table, "cellDivision", value_buff) == 1)
+		para->cellDivision = atoi(value_buff);
+
+	if(getInputValue(table, "rebinMode", value_buff) == 1)
+		copyString(para->rebinMode, sizeof(para->rebinMode), "rebinMode", value_buff);
+
+	if(getInputValue(table, "cellOrder", value_buff) == 1)
+		copyString(para->cellOrder, sizeof(para->cellOrder), "cellOrder", value_buff);
+
+	if(getInputValue(table, "sortInterval", value_buff) == 1)
+		para->sortInterval = atoi(value_buff);
+
+	if(getInputValue(table, "tileSize", value_buff) == 1)
+		para->tileSize = atoi(value_buff);
+
+	if(getInputValue(table, "forceEngine", value_buff) == 1)
+		copyString(para->forceEngine, sizeof(para->forceEngine), "forceEngine", value_buff);
+
+	if(getInputValue(table, "newton", value_buff) == 1)
+		para->newton = atoi(value_buff);
+
+	if(getInputValue(table, "respaSteps", value_buff) == 1)
+		para->respaSteps = atoi(value_buff);
+
+	if(getInputValue(table, "respaCutoff", value_buff) == 1)
+		para->respaCutoff = strtod(value_buff, NULL);
+
+	if(getInputValue(table, "respaSwitch", value_buff) == 1)
+		para->respaSwitch = strtod(value_buff, NULL);
+
+	if(getInputValue(table, "boundary", value_buff) == 1)
+		copyString(para->boundary, sizeof(para->boundary), "boundary", value_buff);
+
+	if(getInputValue(table, "hugePages", value_buff) == 1)
+		copyString(para->hugePages, sizeof(para->hugePages), "hugePages", value_buff);
+
+	if(getInputValue(table, "affinity", value_buff) == 1)
+		copyString(para->affinity, sizeof(para->affinity), "affinity", value_buff);
+
+	if(getInputValue(table, "initFile", value_buff) == 1)
+		copyString(para->initFile, sizeof(para->initFile), "initFile", value_buff);
+
+	if(getInputValue(table, "initFormat", value_buff) == 1)
+		copyString(para->initFormat, sizeof(para->initFormat), "initFormat", value_buff);
+
+	checkInputNames(table);
+	free(table);
+
 	return para;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #define PARAMETER_H_
 
 #define INPUTFILE_PATH "./input/parameter"
+#define PATH_MAX_LENGTH 4096 // 文件路径参数的最大字符数
 
 #include "mytype.h"
 
@@ -14,17 +15,42 @@ typedef struct ParameterStr{
    	int xLat;             // X轴上的晶格数
    	int yLat;             // Y轴上的晶格数
    	int zLat;             // Z轴上的晶格数
-   	int xProc;          // X轴上的进程数
+   	int xProc;          // X轴上的进程数, 为0时与其他为0的维度一起自动选择
    	int yProc;          // Y轴上的进程数
    	int zProc;          // Z轴上的进程数
    	int stepNums;         // 模拟的总步数
    	int printNums;      // 每多少步打印一次信息
    	double stepTime;          // 步长（飞秒）
    	double initTemper; // 初始温度
+   	int mixedPrecision; // 是否使用混合精度计算作用力(单精度相对坐标，双精度累加)
+   	char interpolation[16]; // 势函数插值表的插值方式: none, linear, cubic
+   	int tablePoints;      // 插值表的区间数
+   	char potentialFile[PATH_MAX_LENGTH+1]; // 势函数数据文件路径
+   	char elements[128];   // 以逗号分隔的元素列表, 如 Cu,Ag
+   	char speciesMode[16]; // 元素分布方式: basis, random
+   	double substituteFraction; // random方式下被替换为其他元素的比例
+   	int balanceInterval;  // 每多少步进行一次负载均衡, 0为不进行
+   	int cellDivision;     // 细胞长度为截断距离的1/cellDivision, 通信区域为cellDivision层细胞
+   	char rebinMode[16];   // 原子重新分配至细胞的方式: move(逐个移动), sort(计数排序整体重排)
+   	char cellOrder[16];   // 本空间细胞的排列顺序: xyz, morton
+   	int sortInterval;     // 每调整多少次原子所在细胞后对细胞内的原子排序, 0为不排序
+   	int tileSize;         // 作用力计算分块在各维度上的细胞数, 0为根据L2缓存大小自动选择
+   	char forceEngine[16]; // 对势作用力的计算方式: cell(逐个原子对), cluster(簇对)
+   	int newton;           // 为1时跨进程边界的原子对只计算一次, 通信区域原子所受的力传回属主进程
+   	int respaSteps;       // 多时间步积分每个外层步包含的内层步数(stepTime为内层步长), 1为不使用
+   	double respaCutoff;   // 多时间步积分的内层截断距离, 0为截断距离的0.7倍
+   	double respaSwitch;   // 内外层切换区间的宽度, 0为截断距离的0.15倍
+   	char affinity[16];    // 进程绑定方式: none(由mpirun决定), compact(紧凑绑定到物理核)
+   	char hugePages[16];   // 原子数组所用的页: none(普通页), thp(透明大页), hugetlb(hugetlbfs预留的大页)
+   	char boundary[4];     // x, y, z三个维度的边界条件: p(周期性), f(固定, 越出的原子丢弃), s(收缩包裹, 体系随原子扩大)
+   	                      // f维度上构型与边界之间须留出真空层, 否则热运动的表面原子即越出而被丢弃, 丢弃数随能量输出
+	char initFile[PATH_MAX_LENGTH+1]; // 初始构型文件, none为生成面心立方晶格
+	char initFormat[16];  // 初始构型文件的格式: xyz, lammps(LAMMPS data, atomic)
 
 }Parameter;
 
-// 从文件中解析出各参数
-Parameter* readParameter(); 
+// 从文件及命令行参数中解析出各参数, 所有进程一同调用
+// 输入文件只由0号进程读取一次; 命令行参数 --name=value 覆盖文件中的值, --input=path 指定输入文件
+Parameter* readParameter(int argc, char** argv); 
 
 #endif
\ No newline at end of file
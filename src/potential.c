@@ -1,154 +1,547 @@
 #include "potential.h"
+#include "parameter.h"
 #include "cell.h"
 #include "atom.h"
 #include "system.h"
 #include "timer.h"
+#include "error.h"
+#include "memory.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 
+// 一对元素的LJ参数
+typedef struct LJParamStr{
+
+	double sigma;
+	double epsilon;
+
+}LJParam;
+
+// LJ势: E = 4ε[(σ/r)^12 - (σ/r)^6]
+static void pairLJ(void* arg, double r, double* e, double* dedr){
+
+	LJParam* lj = (LJParam*)arg;
+	double sr6 = pow(lj->sigma/r, 6);
+	*e = 4.0*lj->epsilon*sr6*(sr6 - 1.0);
+	*dedr = -24.0*lj->epsilon*sr6*(2.0*sr6 - 1.0)/r;
+}
+
+// Morse势: E = De[exp(-2β(r-re)) - 2exp(-β(r-re))]
+static void pairMorse(void* arg, double r, double* e, double* dedr){
+
+	Potential* potential = (Potential*)arg;
+	double t = exp(-potential->Beta*(r - potential->re));
+	*e = potential->De*(t*t - 2.0*t);
+	*dedr = 2.0*potential->Beta*potential->De*(t - t*t);
+}
+
+// Buckingham势: E = A exp(-r/ρ) - C/r^6
+static void pairBuckingham(void* arg, double r, double* e, double* dedr){
+
+	Potential* potential = (Potential*)arg;
+	double t = potential->buckA*exp(-r/potential->buckRho);
+	double r6 = 1.0/pow(r, 6);
+	*e = t - potential->buckC*r6;
+	*dedr = -t/potential->buckRho + 6.0*potential->buckC*r6/r;
+}
+
+// 以下为力计算循环中内联的求值函数, 由类型对下标ij及r²求势能(减去截断处的值)及(dE/dr)/r
+
+static inline void evalLJ(const Potential* pot, int ij, double r2, double* e, double* fr){
+
+	double rinv2 = 1.0/r2;
+	double s2 = pot->sigma2[ij]*rinv2;
+	double r6 = s2*s2*s2;
+	*fr = -pot->eps4[ij]*r6*rinv2*(12.0*r6 - 6.0);
+	*e = pot->eps4[ij]*r6*(r6 - 1.0) - pot->eShift[ij];
+}
+
+static inline void evalMorse(const Potential* pot, int ij, double r2, double* e, double* fr){
+
+	double r = sqrt(r2);
+	double t = exp(-pot->Beta*(r - pot->re));
+	*fr = 2.0*pot->Beta*pot->De*(t - t*t)/r;
+	*e = pot->De*(t*t - 2.0*t) - pot->eShift[ij];
+}
+
+static inline void evalBuckingham(const Potential* pot, int ij, double r2, double* e, double* fr){
+
+	double r = sqrt(r2);
+	double t = pot->buckA*exp(-r/pot->buckRho);
+	double r6 = 1.0/(r2*r2*r2);
+	*fr = (-t/pot->buckRho)/r + 6.0*pot->buckC*r6/r2;
+	*e = t - pot->buckC*r6 - pot->eShift[ij];
+}
+
+static inline void evalTable(const Potential* pot, int ij, double r2, double* e, double* fr){
+
+	potTableEval(pot->table[ij], r2, e, fr);
+}
+
+// 由模板生成各势函数的力计算函数
+#define PAIR_KERNEL_NAME computeForceLJ
+#define PAIR_EVAL evalLJ
+#include "pairkernel.h"
+
+#define PAIR_KERNEL_NAME computeForceMorse
+#define PAIR_EVAL evalMorse
+#include "pairkernel.h"
+
+#define PAIR_KERNEL_NAME computeForceBuckingham
+#define PAIR_EVAL evalBuckingham
+#include "pairkernel.h"
+
+#define PAIR_KERNEL_NAME computeForceTable
+#define PAIR_EVAL evalTable
+#include "pairkernel.h"
+
+// 簇对方式的力计算函数
+#define CLUSTER_KERNEL_NAME computeForceLJCluster
+#define PAIR_EVAL evalLJ
+#include "clusterkernel.h"
+
+#define CLUSTER_KERNEL_NAME computeForceMorseCluster
+#define PAIR_EVAL evalMorse
+#include "clusterkernel.h"
+
+#define CLUSTER_KERNEL_NAME computeForceBuckinghamCluster
+#define PAIR_EVAL evalBuckingham
+#include "clusterkernel.h"
+
+#define CLUSTER_KERNEL_NAME computeForceTableCluster
+#define PAIR_EVAL evalTable
+#include "clusterkernel.h"
+
+// 多时间步积分的力计算函数
+#define RESPA_KERNEL_NAME computeForceLJRespa
+#define PAIR_EVAL evalLJ
+#include "respakernel.h"
+
+#define RESPA_KERNEL_NAME computeForceMorseRespa
+#define PAIR_EVAL evalMorse
+#include "respakernel.h"
+
+#define RESPA_KERNEL_NAME computeForceBuckinghamRespa
+#define PAIR_EVAL evalBuckingham
+#include "respakernel.h"
+
+#define RESPA_KERNEL_NAME computeForceTableRespa
+#define PAIR_EVAL evalTable
+#include "respakernel.h"
+
+static void computeForceMixed(struct SystemStr* sys);
+
+// 势函数注册表, 以势函数名为键
+typedef struct PotEntryStr{
+
+	const char* name;                              // 势函数名
+	PairFunc pairFunc;                             // 用于生成插值表的对势函数
+	int typed;                                     // 参数是否随元素种类变化
+	void (*computeforce)(struct SystemStr* sys);   // 解析形式的力计算函数
+	void (*computeforceMixed)(struct SystemStr* sys); // 混合精度的力计算函数, 不支持时为NULL
+	void (*computeforceCluster)(struct SystemStr* sys); // 簇对方式的力计算函数, 不支持时为NULL
+	void (*computeforceRespa)(struct SystemStr* sys, int outer); // 多时间步积分的力计算函数, 不支持时为NULL
+
+}PotEntry;
+
+static const PotEntry potRegistry[] = {
+	{"LJ",         pairLJ,         1, computeForceLJ,         computeForceMixed, computeForceLJCluster,
+		computeForceLJRespa},
+	{"Morse",      pairMorse,      0, computeForceMorse,      NULL, computeForceMorseCluster,
+		computeForceMorseRespa},
+	{"Buckingham", pairBuckingham, 0, computeForceBuckingham, NULL, computeForceBuckinghamCluster,
+		computeForceBuckinghamRespa},
+	{"File",       pairSplineEval, 0, NULL,                   NULL, NULL, NULL},   // 只能通过插值表计算
+	{"EAM",        NULL,           1, computeForceEam,        NULL, NULL, NULL},   // 参数由势函数文件给出
+};
+
+// 将各原子类型对应到EAM势函数文件中的同名元素, funcfl格式只有一种元素
+static void mapEamTypes(EamPot* eam, Lattice* lattice){
+
+	for (int t = 0; t < lattice->typeNum; t++){
+		eam->typeMap[t] = -1;
+		if (strcmp(eam->format, "funcfl") == 0){
+			if (lattice->typeNum == 1)
+				eam->typeMap[t] = 0;
+		}
+		else
+			for (int e = 0; e < eam->elemNum; e++)
+				if (strcmp(lattice->atomName[t], eam->elemName[e]) == 0)
+					eam->typeMap[t] = e;
+		if (eam->typeMap[t] < 0){
+			errorInfo(elemName);
+			exit(elemName);
+		}
+	}
+}
+
 // 初始化势函数结构体
-void initPotInfo(Potential** pot){
+void initPotInfo(Potential** pot, struct ParameterStr* para, Lattice* lattice){
 
 
 	*pot = (Potential*)malloc(sizeof(Potential));
 	Potential* potential= *pot;
 	
-	strcpy(potential->potentialType,"Morse");
-	 // potential->De = 0.3429;	                  
-	 // 	potential->re = 2.866;
-		// potential->Beta = 1.3588;
+	strcpy(potential->potentialType, para->potentialName);
+	potential->De = 0.3429;	                  
+	potential->re = 2.866;
+	potential->Beta = 1.3588;
+	// 与LJ参数相匹配的示例参数: 极小值位于最近邻距离处，势阱深度与LJ相同
+	potential->buckA = 6546.0;
+	potential->buckRho = 0.25;
+	potential->buckC = 112.6;
 	  	potential->cutoff = 5.7875;
-	potential->sigma = 2.315;	                  // Angstrom
-   potential->epsilon = 0.167;
 
-		//potential->computeforce = computeForce;
+   potential->mixedPrecision = para->mixedPrecision;
+   if (strcmp(para->forceEngine, "cell") == 0)
+   	potential->clusterEngine = 0;
+   else if (strcmp(para->forceEngine, "cluster") == 0)
+   	potential->clusterEngine = 1;
+   else{
+   	errorInfo(forceEngine);
+   	exit(forceEngine);
+   }
+   if (strcmp(para->interpolation, "none") != 0 && strcmp(para->interpolation, "linear") != 0
+   	&& strcmp(para->interpolation, "cubic") != 0){
+   	errorInfo(interpolation);
+   	exit(interpolation);
+   }
+   if (para->tablePoints < 2){
+   	errorInfo(tablePoints);
+   	exit(tablePoints);
+   }
+   potential->newton = para->newton;
+   potential->respaSteps = para->respaSteps > 1 ? para->respaSteps : 1;
+   potential->slowForce = NULL;
+   potential->slowSlots = 0;
+   potential->computeforceRespa = NULL;
+   potential->typeNum = lattice->typeNum;
+   potential->tableNum = 0;
+   potential->spline = NULL;
+   potential->eam = NULL;
+   int typeNum = potential->typeNum;
+   for (int ij = 0; ij < MAXTYPES*MAXTYPES; ij++){
+   	potential->table[ij] = NULL;
+   	potential->eShift[ij] = 0.0;
+   }
+
+   // LJ参数按Lorentz-Berthelot规则混合: σ_ij = (σ_i+σ_j)/2, ε_ij = sqrt(ε_i ε_j)
+   double sigmaMax = 0.0;
+   for (int i = 0; i < typeNum; i++)
+   	for (int j = 0; j < typeNum; j++){
+   		double sigma = 0.5*(lattice->sigma[i] + lattice->sigma[j]);
+   		potential->sigma2[i*typeNum+j] = sigma*sigma;
+   		potential->eps4[i*typeNum+j] = 4.0*sqrt(lattice->epsilon[i]*lattice->epsilon[j]);
+   		if (sigma > sigmaMax)
+   			sigmaMax = sigma;
+   	}
+
+   // 在注册表中查找势函数
+   const PotEntry* entry = NULL;
+   for (int i = 0; i < (int)(sizeof(potRegistry)/sizeof(PotEntry)); i++)
+   	if (strcmp(para->potentialName, potRegistry[i].name) == 0)
+   		entry = &potRegistry[i];
+   if (entry == NULL){
+   	errorInfo(potName);
+   	exit(potName);
+   }
+
+   // EAM势的截断距离等参数均由势函数文件给出
+   if (strcmp(entry->name, "EAM") == 0){
+   	if (potential->respaSteps > 1){
+   		errorInfo(respaPot);
+   		exit(respaPot);
+   	}
+   	potential->eam = readEamPot(para->potentialFile, para->tablePoints);
+   	if (potential->eam == NULL){
+   		errorInfo(potFile);
+   		exit(potFile);
+   	}
+   	mapEamTypes(potential->eam, lattice);
+   	potential->cutoff = potential->eam->cutoff;
+   	potential->computeforce = entry->computeforce;
+   	potential->newton = 0;   // 嵌入能需要完整的电子密度, 通信区域的原子对仍由两侧各算一次
+   	strcpy(potential->kernelName, "EAM(两遍)");
+   	return;
+   }
+
+   // LJ势的截断距离取2.5倍的最大σ_ij
+   if (strcmp(entry->name, "LJ") == 0)
+   	potential->cutoff = 2.5*sigmaMax;
+
+   // 文件给出的对势截断于最后一个数据点, 插值表须在数据范围之内
+   if (strcmp(entry->name, "File") == 0){
+   	potential->spline = readPairSpline(para->potentialFile);
+   	if (potential->spline == NULL || potential->spline->r[potential->spline->num-1] <= TABLE_RMIN){
+   		errorInfo(potFile);
+   		exit(potFile);
+   	}
+   	potential->cutoff = potential->spline->r[potential->spline->num-1];
+   }
+
+   // 指定插值方式或没有解析形式时使用插值表
+   int useTable = entry->computeforce == NULL || strcmp(para->interpolation, "none") != 0;
+   int cubic = strcmp(para->interpolation, "linear") != 0;
+
+   // 各类型对截断处的势能及插值表, 参数不随元素种类变化的势函数所有类型对共用同一组
+   for (int i = 0; i < typeNum; i++)
+   	for (int j = 0; j <= i; j++){
+
+   		int ij = i*typeNum+j;
+   		int ji = j*typeNum+i;
+   		if (! entry->typed && ij > 0){
+   			potential->eShift[ij] = potential->eShift[ji] = potential->eShift[0];
+   			potential->table[ij] = potential->table[ji] = potential->table[0];
+   			continue;
+   		}
+
+   		LJParam lj = {sqrt(potential->sigma2[ij]), 0.25*potential->eps4[ij]};
+   		void* arg = potential;
+   		if (strcmp(entry->name, "LJ") == 0)
+   			arg = &lj;
+   		else if (strcmp(entry->name, "File") == 0)
+   			arg = potential->spline;
+
+   		// 截断处的势能, 使势能在截断处连续
+   		double dedr;
+   		entry->pairFunc(arg, potential->cutoff, &potential->eShift[ij], &dedr);
+   		potential->eShift[ji] = potential->eShift[ij];
+
+   		if (useTable){
+   			PotTable* table = buildPotTable(entry->pairFunc, arg, TABLE_RMIN, potential->cutoff,
+   				para->tablePoints, cubic);
+   			potential->tables[potential->tableNum++] = table;
+   			potential->table[ij] = potential->table[ji] = table;
+   		}
+   	}
+
+   // 选择力计算函数, 簇对方式优先于混合精度
+   if (useTable && potential->clusterEngine){
+   	potential->computeforce = computeForceTableCluster;
+   	strcpy(potential->kernelName, "插值表(簇对)");
+   }
+   else if (useTable){
+   	potential->computeforce = computeForceTable;
+   	strcpy(potential->kernelName, "插值表");
+   }
+   else if (potential->clusterEngine && entry->computeforceCluster){
+   	potential->computeforce = entry->computeforceCluster;
+   	sprintf(potential->kernelName, "%s(簇对)", entry->name);
+   }
+   else if (potential->mixedPrecision && entry->computeforceMixed){
+   	potential->computeforce = entry->computeforceMixed;
+   	sprintf(potential->kernelName, "%s(混合精度)", entry->name);
+   }
+   else{
+   	potential->computeforce = entry->computeforce;
+   	sprintf(potential->kernelName, "%s(解析)", entry->name);
+   }
+
+   // 多时间步积分: 内层截断及切换区间默认取截断距离的0.7倍及0.15倍
+   if (potential->respaSteps > 1){
+   	potential->respaCutoff = para->respaCutoff > 0.0 ? para->respaCutoff : 0.7*potential->cutoff;
+   	potential->respaSwitch = para->respaSwitch > 0.0 ? para->respaSwitch : 0.15*potential->cutoff;
+   	if (potential->respaCutoff >= potential->cutoff || potential->respaSwitch >= potential->respaCutoff){
+   		errorInfo(respaCutoff);
+   		exit(respaCutoff);
+   	}
+   	potential->computeforceRespa = useTable ? computeForceTableRespa : entry->computeforceRespa;
+   	potential->newton = 0;   // 外层力不经过逆向通信
+   	if (useTable)
+   		strcpy(potential->kernelName, "插值表(r-RESPA)");
+   	else
+   		sprintf(potential->kernelName, "%s(r-RESPA)", entry->name);
+   }
 		//potential->free = potentialFree;
 }
 
 // 释放结构体空间
 void potentialFree(Potential* potential){
-	if(potential)
+	if(potential){
+		for (int i = 0; i < potential->tableNum; i++)
+			freePotTable(potential->tables[i]);
+		freePairSpline(potential->spline);
+		freeEamPot(potential->eam);
+		freeBlock(potential->slowForce);
 		free(potential);
+	}
 }
 
-// 根据势函数，求原子间的相互作用力, 选取morse势函数
+// 根据势函数，求原子间的相互作用力及各原子的势能
 void  computeForce(struct SystemStr* sys){
 
+	// 多时间步积分时计算完整的内外层力
+	if (sys->potential->respaSteps > 1){
+		computeForceRespa(sys, 1);
+		return;
+	}
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+   	// 力和势能置0, 只处理各细胞中有原子的槽位
+   	for (int c=0; c<cells->totalCellNum; c++)
+   		for (int i=cells->cellStart[c],count=0; count<cells->atomNum[c]; count++,i++){
+   			for(int j=0;j<3;j++)
+      			atoms->force[i][j] = 0.0;
+      		atoms->pot[i] = 0.0;
+    	}
+
+    sys->potential->computeforce(sys);
+
+    if (sys->potential->newton)
+    	reverseGhostForce(sys);
+}
+
+// 多时间步积分中计算作用力: outer为0时只计算内层力, 为1时同时计算外层力及完整的势能
+void computeForceRespa(struct SystemStr* sys, int outer){
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
 	Potential* potential = sys->potential;
-		//  double De = potential->De;
-		//  double Beta = potential->Beta;
-		// double re = potential->re;
-		//  double cutoff = potential->cutoff;
-	double sigma = potential->sigma;
-   double epsilon = potential->epsilon;
-   double rCut = potential->cutoff;
-   double rCut2 = rCut*rCut;
 
-    double s6 = sigma*sigma*sigma*sigma*sigma*sigma;
+	if (outer && cells->slotNum > potential->slowSlots){
+		potential->slowSlots = cells->slotNum;
+		freeBlock(potential->slowForce);
+		potential->slowForce = (double3*)allocBlock(cells->slotNum*sizeof(double3));
+	}
+
+   	// 力和势能置0, 只处理各细胞中有原子的槽位
+   	for (int c=0; c<cells->totalCellNum; c++)
+   		for (int i=cells->cellStart[c],count=0; count<cells->atomNum[c]; count++,i++){
+   			for(int j=0;j<3;j++){
+      			atoms->force[i][j] = 0.0;
+      			if (outer)
+      				potential->slowForce[i][j] = 0.0;
+      		}
+      		atoms->pot[i] = 0.0;
+    	}
+
+    potential->computeforceRespa(sys, outer);
+}
 
-   double rCut6 = s6 / (rCut2*rCut2*rCut2);
+// 混合精度计算LJ势函数的作用力
+// 原子坐标以相对所在细胞原点的单精度偏移量存储，细胞之间的原点差以双精度求出后再转为单精度，
+// 因此距离的精度只取决于细胞尺度而不是体系尺度；每对原子的力以单精度求得，在双精度中累加
+static void computeForceMixed(struct SystemStr* sys){
 
-		Cell* cells = sys->cells;
+	Potential* potential = sys->potential;
+   float rCut2 = (float)(potential->cutoff*potential->cutoff);
+
+   // 单精度的类型对参数表, 内层循环按原子类型从中取值
+   int typeNum = potential->typeNum;
+   float s6[MAXTYPES*MAXTYPES], eps4[MAXTYPES*MAXTYPES], eShift[MAXTYPES*MAXTYPES];
+   for (int ij = 0; ij < typeNum*typeNum; ij++){
+   	double s2 = potential->sigma2[ij];
+   	s6[ij] = (float)(s2*s2*s2);
+   	eps4[ij] = (float)potential->eps4[ij];
+   	eShift[ij] = (float)potential->eShift[ij];
+   }
+
+	Cell* cells = sys->cells;
 	Atom* atoms = sys->atoms;
 
-   	// 力置0
-   	for(int i=0; i<cells->totalCellNum*MAXPERCELL; i++)
-   		for(int j=0;j<3;j++)
-      		atoms->force[i][j] = 0.0;
-   
-   //real_t s6 = sigma*sigma*sigma*sigma*sigma*sigma;
-   // real_t rCut6 = s6 / (rCut2*rCut2*rCut2);
-   // real_t eShift = POT_SHIFT * rCut6 * (rCut6 - 1.0);
-      	//printf("myatomnum: %d\n",sys->atoms->myNum);
-      	//beginTimer(force);
-      	//int calls1=0,calls2=0,calls3=0,calls4=0,calls5=0,calls6=0,calls7=0;
-   	for (int cell1 = 0; cell1<cells->myCellNum; cell1++)
+	// 计算所有细胞(包括通信区域)中原子的相对坐标
+   	for (int nCell=0; nCell<cells->totalCellNum; nCell++)
    	{
-   		//calls1++;
+   		double3 origin;
+   		if (cells->atomNum[nCell] == 0)
+   			continue;
+   		getCellOrigin(cells, sys->space, nCell, origin);
+      	for (int n=cells->cellStart[nCell],count=0; count<cells->atomNum[nCell]; count++,n++)
+      		for(int i=0;i<3;i++)
+         		atoms->relPos[i][n] = (float)(atoms->pos[n][i] - origin[i]);
+    }
+
+   	for (int k1 = 0; k1<cells->activeNum; k1++)
+   	{
+      	int cell1 = cells->active[k1];
       	int atomnum1 = cells->atomNum[cell1];
       	if ( atomnum1 == 0 ) 
       		continue;
 
-      	//calls2++;
-      	int3 cell1xyz,cell2xyz;
+      	int pad1 = cells->cellToPad[cell1];
+      	double3 origin1,origin2;
       	
-      	getXYZByCell(cells,cell1xyz,cell1);
+      	getCellOrigin(cells, sys->space, cell1, origin1);
 
-   		for(cell2xyz[0]=cell1xyz[0]-1;cell2xyz[0]<=cell1xyz[0]+1;cell2xyz[0]++)
-   			for(cell2xyz[1]=cell1xyz[1]-1;cell2xyz[1]<=cell1xyz[1]+1;cell2xyz[1]++)
-   				for(cell2xyz[2]=cell1xyz[2]-1;cell2xyz[2]<=cell1xyz[2]+1;cell2xyz[2]++)
+   		// 只遍历与截断球相交的邻居细胞
+   		for (int s = 0; s < cells->stencilNum; s++)
    				{
-   					//calls3++;
-   					
-   					int cell2 = findCellByXYZ(cells,cell2xyz);
+   					int cell2 = cells->padToCell[pad1 + cells->stencil[s]];
 	
    					int atomnum2 = cells->atomNum[cell2];
    					if ( atomnum2 == 0 ) 
       					continue;
 
-      				//calls4++;
-					//beginTimer(test);
-      				for (int n1=cell1*MAXPERCELL,count1=0; count1<atomnum1; count1++,n1++)
+      				// 两个细胞原点之差
+      				getCellOrigin(cells, sys->space, cell2, origin2);
+      				float shift[3];
+      				for (int i=0; i<3; i++)
+      					shift[i] = (float)(origin1[i] - origin2[i]);
+
+      				// 启用作用力回传时, 与通信区域细胞的原子对只在偏移为正的一侧计算:
+      				// 对侧进程看到同一对原子时偏移的符号相反, 由其跳过; 本空间细胞之间按槽位先后去重
+      				int ownCell2 = cell2 < cells->myCellNum;
+      				if (! ownCell2 && potential->newton && cells->stencil[s] < 0)
+      					continue;
+      				float* x2 = atoms->relPos[0] + cells->cellStart[cell2];
+      				float* y2 = atoms->relPos[1] + cells->cellStart[cell2];
+      				float* z2 = atoms->relPos[2] + cells->cellStart[cell2];
+      				int first2 = cells->cellStart[cell2];
+      				int* type2 = atoms->type + cells->cellStart[cell2];
+
+      				for (int n1=cells->cellStart[cell1],count1=0; count1<atomnum1; count1++,n1++)
          			{
-         					int id1 = atoms->id[n1];
-         				
-         				for (int n2=cell2*MAXPERCELL,count2=0; count2<atomnum2; count2++,n2++)
+         				int it1 = atoms->type[n1]*typeNum;
+         				float x1 = atoms->relPos[0][n1] + shift[0];
+         				float y1 = atoms->relPos[1][n1] + shift[1];
+         				float z1 = atoms->relPos[2][n1] + shift[2];
+         				int last = ownCell2 ? n1 : -1; // 只计算槽位大于last的原子
+
+         				// 内层循环无分支，截断与防重复计算均通过掩码实现，便于向量化
+         				float fx[atomnum2], fy[atomnum2], fz[atomnum2], ep[atomnum2];
+         				for (int count2=0; count2<atomnum2; count2++)
             			{
-            				
-            				//calls5++;
-            				int id2 = atoms->id[n2];
-
-           					if (cell2 < cells->myCellNum && id2 <= id1 ){ // <=  or < ???
-                  				continue; // 防止重复计算
-                  			} 
-
-                  			double3 r_vector;
-           					double r_scalar = 0.0;
-                  			//calls6++;
-                  			for (int i=0; i<3; i++)
-               				{ 
-                  				r_vector[i] = atoms->pos[n1][i]-atoms->pos[n2][i];
-                  				r_scalar += r_vector[i]*r_vector[i];
-               				}
-
-               				if ( r_scalar > rCut2/*cutoff*cutoff*/) {
-               					continue;
-               				}
-               				//calls7++;
-               				r_scalar = 1.0/r_scalar;
-               				double r6 = s6 * (r_scalar*r_scalar*r_scalar);
-
-               				double fr = - 4.0*epsilon*r6*r_scalar*(12.0*r6 - 6.0);
-              				 for (int m=0; m<3; m++)
-               				{
-                  				atoms->force[n1][m] -= r_vector[m]*fr;
-                  				atoms->force[n2][m] += r_vector[m]*fr;
-               				}
-               				//beginTimer(force);
-               				 // r_scalar = sqrt(r_scalar);
-
-               				 // double force_scalar = 0.0;
-
-               				 // double t = 1.0/(exp(Beta*(r_scalar-re)));
-               				 // force_scalar = 2*Beta*De*(t-t*t);
- 
-               				 // for (int i=0; i<3; i++)
-               				 // {
-                  	 // 			atoms->force[n1][i] -= (r_vector[i]/r_scalar)*force_scalar;
-                  	 // 			atoms->force[n2][i] += (r_vector[i]/r_scalar)*force_scalar;
-               				 // } 
-               				//endTimer(force); 
-   						}  
-   						    
+            				float dx = x1 - x2[count2];
+            				float dy = y1 - y2[count2];
+            				float dz = z1 - z2[count2];
+            				float r2 = dx*dx + dy*dy + dz*dz;
+
+            				int valid = (r2 <= rCut2) & (first2+count2 > last);
+            				float mask = (float)valid;
+            				float rinv2 = mask/(r2 + 1.0f - mask);
+            				int ij = it1 + type2[count2];
+            				float r6 = s6[ij]*rinv2*rinv2*rinv2;
+            				float fr = -eps4[ij]*r6*rinv2*(12.0f*r6 - 6.0f);
+
+            				fx[count2] = dx*fr;
+            				fy[count2] = dy*fr;
+            				fz[count2] = dz*fr;
+            				ep[count2] = mask*0.5f*(eps4[ij]*r6*(r6 - 1.0f) - eShift[ij]);
+            			}
+
+            			// 在双精度中累加
+            			double3 f1 = {0.0, 0.0, 0.0};
+            			double e1 = 0.0;
+            			for (int n2=cells->cellStart[cell2],count2=0; count2<atomnum2; count2++,n2++)
+            			{
+            				f1[0] += fx[count2];
+            				f1[1] += fy[count2];
+            				f1[2] += fz[count2];
+            				e1 += ep[count2];
+            				atoms->force[n2][0] += fx[count2];
+            				atoms->force[n2][1] += fy[count2];
+            				atoms->force[n2][2] += fz[count2];
+            				atoms->pot[n2] += ep[count2];
+            			}
+            			for (int m=0; m<3; m++)
+            				atoms->force[n1][m] -= f1[m];
+            			atoms->pot[n1] += e1;
             		}
-            		
-            		//endTimer(test);
          		}
-         		//printf("calls:%d\n",calls );
     }
-    //endTimer(force);
-	//printf("calls1: %d calls2: %d calls3: %d calls4: %d calls5: %d calls6: %d calls7: %d\n",calls1,calls2,calls3,calls4,calls5,calls6,calls7);
-}
\ No newline at end of file
+}
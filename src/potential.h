@@ -4,28 +4,62 @@
 #ifndef POTENTIAL_H_
 #define POTENTIAL_H_
 
+#include "mytype.h"
+#include "table.h"
+#include "eam.h"
+#include "lattice.h"
+
 struct SystemStr;
+struct ParameterStr;
 
 typedef struct PotentialStr{
 	
 	char potentialType[30]; //势函数类型
 	
-	 // double De;
-  //   	double re;
-  //   	double Beta;
+	double De;     // Morse势参数
+	double re;
+	double Beta;
+
+	double buckA;  // Buckingham势参数
+	double buckRho;
+	double buckC;
 
     	double cutoff; //截断距离
-	double sigma;
-   double epsilon;
 
-	//void  (*computeforce)(struct SystemStr* sys); // 计算相互作用力的函数
+   // 以下按类型对展开的参数表, 类型对(i,j)的下标为 i*typeNum+j
+   int typeNum;                          // 元素种数
+   double sigma2[MAXTYPES*MAXTYPES];     // LJ参数σ_ij², 按Lorentz-Berthelot规则混合
+   double eps4[MAXTYPES*MAXTYPES];       // LJ参数4ε_ij
+   double eShift[MAXTYPES*MAXTYPES];     // 截断处的势能，使势能在截断处连续
+
+   int tableNum;                         // 插值表个数
+   PotTable* tables[MAXTYPES*MAXTYPES];  // 各插值表, 不随元素种类变化的势函数只有一个
+   PotTable* table[MAXTYPES*MAXTYPES];   // 各类型对所用的插值表, 为NULL时使用解析形式
+   PairSpline* spline;  // 由文件读入的对势数据
+   EamPot* eam;         // EAM势函数数据, 非EAM势时为NULL
+
+   int mixedPrecision; // 是否使用混合精度计算作用力
+   int clusterEngine;  // 是否以簇对方式计算对势作用力
+   int newton;         // 跨进程边界的原子对是否只计算一次, 通信区域原子所受的力传回属主进程
+
+   // 多时间步(r-RESPA)积分: 对势以切换函数分为内层与外层两部分, 外层力每respaSteps步计算一次
+   int respaSteps;       // 每个外层步包含的内层步数, 为1时不使用多时间步
+   double respaCutoff;   // 内层截断距离
+   double respaSwitch;   // 切换函数区间的宽度, 区间为[respaCutoff-respaSwitch, respaCutoff]
+   double3* slowForce;   // 各槽位原子所受的外层力
+   int slowSlots;        // slowForce已分配的槽位数
+   void (*computeforceRespa)(struct SystemStr* sys, int outer); // 分内外层计算作用力的函数
+
+	char kernelName[30];  // 所选用的力计算函数
+
+	void  (*computeforce)(struct SystemStr* sys); // 计算相互作用力的函数, 由势函数注册表选定
    	//可以单独拿出来 void (*print)(FILE* f, Potential* potential); // 打印势函数相关信息的函数
    	//void (*free)(Potential* potential); // 释放结构体空间的函数
    	
 }Potential;
 
 // 初始化势函数结构体
-void initPotInfo(Potential** pot);
+void initPotInfo(Potential** pot, struct ParameterStr* para, Lattice* lattice);
 
 // 释放结构体空间
 void potentialFree(Potential* potential);
@@ -33,4 +67,7 @@ void potentialFree(Potential* potential);
 // 根据势函数，求原子间的相互作用力
 void computeForce(struct SystemStr* sys);
 
-#endif
\ No newline at end of file
+// 多时间步积分中计算作用力: outer为0时只计算内层力, 为1时同时计算外层力及完整的势能
+void computeForceRespa(struct SystemStr* sys, int outer);
+
+#endif
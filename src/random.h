@@ -3,14 +3,32 @@
 
 #include "mytype.h"
 #include <stdint.h>
+#include <math.h>
 
-/// Return a random number from a Gaussian distribution.
-double gasdev(uint64_t* seed);
+/// Counter-based generator: the k-th uniform number in (0,1) of the stream
+/// (id, callSite). No state and no warmup, so a loop over atoms has no
+/// dependence between iterations and can be vectorized.
+static inline double uniformAt(uint64_t id, uint32_t callSite, uint32_t k)
+{
+   uint64_t x = id*UINT64_C(0x9E3779B97F4A7C15) ^ (((uint64_t)callSite << 32) | k);
+   x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+   x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+   x ^= x >> 31;
+   return ((x >> 11) + 0.5) * (1.0/9007199254740992.0);
+}
 
-/// Return a random number from a uniform distribution.
-double lcg61(uint64_t* seed);
-
-/// Return a seed suitable for calling lcg61 or gasdev.
-uint64_t mkSeed(uint32_t id, uint32_t callSite);
+/// Three Gaussian numbers of the stream (id, callSite), by two Box-Muller
+/// transforms without rejection.
+static inline void gaussAt(uint64_t id, uint32_t callSite, double g[3])
+{
+   static const double twoPi = 6.283185307179586;
+   double r1 = sqrt(-2.0*log(uniformAt(id, callSite, 0)));
+   double a1 = twoPi*uniformAt(id, callSite, 1);
+   double r2 = sqrt(-2.0*log(uniformAt(id, callSite, 2)));
+   double a2 = twoPi*uniformAt(id, callSite, 3);
+   g[0] = r1*cos(a1);
+   g[1] = r1*sin(a1);
+   g[2] = r2*cos(a2);
+}
 
 #endif
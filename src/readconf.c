@@ -0,0 +1,449 @@
+#define _GNU_SOURCE
+#include "readconf.h"
+#include "system.h"
+#include "mympi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mpi.h>
+
+// 一行的最大长度, 更长的部分被忽略
+#define LINE_MAX_LENGTH 256
+
+// 将pos处开始的一行复制到buf中(去掉换行符), 返回下一行的起始位置
+static size_t copyLine(const ConfFile* conf, size_t pos, char* buf){
+
+	const char* p = memchr(conf->data + pos, '\n', conf->size - pos);
+	size_t end = p ? (size_t)(p - conf->data) : conf->size;
+
+	size_t len = end - pos;
+	if (len > LINE_MAX_LENGTH-1)
+		len = LINE_MAX_LENGTH-1;
+	memcpy(buf, conf->data + pos, len);
+	buf[len] = '\0';
+	return p ? end + 1 : end;
+}
+
+// 第一个起始位置不小于pos的行
+static size_t lineStart(const ConfFile* conf, size_t pos){
+
+	if (pos == 0 || pos >= conf->size)
+		return pos < conf->size ? pos : conf->size;
+	const char* p = memchr(conf->data + pos - 1, '\n', conf->size - pos + 1);
+	return p ? (size_t)(p - conf->data) + 1 : conf->size;
+}
+
+// 跳过行首的空白
+static const char* skipSpace(const char* s){
+
+	while (*s == ' ' || *s == '\t' || *s == '\r')
+		s++;
+	return s;
+}
+
+// LAMMPS data文件头: 在Atoms段之前读取原子数及体系范围, 其他段(如Masses)的内容被忽略
+static int lammpsHeader(ConfFile* conf){
+
+	char buf[LINE_MAX_LENGTH];
+	int boxFound[3] = {0, 0, 0};
+	conf->atomNum = -1;
+
+	// 第一行为注释
+	size_t pos = copyLine(conf, 0, buf);
+	while (pos < conf->size)
+	{
+		pos = copyLine(conf, pos, buf);
+		const char* s = skipSpace(buf);
+
+		if (isalpha((unsigned char)*s)){
+			if (strncmp(s, "Atoms", 5) != 0)
+				continue;
+			conf->begin = pos;
+			break;
+		}
+
+		// 不支持三斜晶胞
+		if (strstr(s, "xy xz yz"))
+			return 0;
+		if (strstr(s, " atoms"))
+			conf->atomNum = strtoll(s, NULL, 10);
+
+		const char* key[3] = {"xlo xhi", "ylo yhi", "zlo zhi"};
+		double lo, hi;
+		for (int i = 0; i < 3; i++){
+			if (strstr(s, key[i]) && sscanf(s, "%lf %lf", &lo, &hi) == 2){
+				conf->boxMin[i] = lo;
+				conf->boxLength[i] = hi - lo;
+				boxFound[i] = 1;
+			}
+		}
+	}
+
+	conf->hasBox = boxFound[0] && boxFound[1] && boxFound[2];
+	return conf->begin > 0 && conf->atomNum >= 0 && conf->hasBox;
+}
+
+// XYZ文件头: 第一行为原子数, 第二行为注释, 其中可有extended XYZ的Lattice="..."
+static int xyzHeader(ConfFile* conf){
+
+	char buf[LINE_MAX_LENGTH];
+	size_t pos = copyLine(conf, 0, buf);
+	char* end;
+	conf->atomNum = strtoll(buf, &end, 10);
+	if (end == buf || conf->atomNum < 0)
+		return 0;
+
+	conf->begin = copyLine(conf, pos, buf);
+	const char* lat = strstr(buf, "Lattice=\"");
+	if (lat){
+		double m[9];
+		if (sscanf(lat + 9, "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
+			&m[0], &m[1], &m[2], &m[3], &m[4], &m[5], &m[6], &m[7], &m[8]) != 9)
+			return 0;
+		for (int i = 0; i < 3; i++){
+			conf->boxMin[i] = 0.0;
+			conf->boxLength[i] = m[4*i];
+		}
+		conf->hasBox = 1;
+	}
+	return 1;
+}
+
+// 映射构型文件并解析文件头, 所有进程一同调用; format为xyz或lammps
+// format无法识别时返回0, 文件无法读取或文件头格式错误时返回-1
+int openConf(const char* path, const char* format, ConfFile* conf){
+
+	memset(conf, 0, sizeof(ConfFile));
+	if (strcmp(format, "lammps") == 0)
+		conf->lammps = 1;
+	else if (strcmp(format, "xyz") != 0)
+		return 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0){
+		close(fd);
+		return -1;
+	}
+	conf->size = st.st_size;
+	void* data = mmap(NULL, conf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return -1;
+	madvise(data, conf->size, MADV_SEQUENTIAL);
+	conf->data = data;
+
+	int ok = conf->lammps ? lammpsHeader(conf) : xyzHeader(conf);
+	if (! ok){
+		closeConf(conf);
+		return -1;
+	}
+	return 1;
+}
+
+// 解除映射
+void closeConf(ConfFile* conf){
+
+	if (conf->data)
+		munmap((void*)conf->data, conf->size);
+	conf->data = NULL;
+}
+
+// 坐标x在planes划分的procNum层中所在的层, 超出两端时取两端的层
+static int ownerLayer(const double* planes, int procNum, double x){
+
+	int lo = 0, hi = procNum - 1;
+	while (lo < hi){
+		int mid = (lo + hi + 1)/2;
+		if (planes[mid] <= x)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+// 读取三个坐标并减去体系范围的下界, 成功时返回1
+static int parseCoord(const ConfFile* conf, const char* s, double3 x){
+
+	char* end;
+	for (int i = 0; i < 3; i++){
+		x[i] = strtod(s, &end);
+		if (end == s)
+			return 0;
+		s = end;
+		x[i] -= conf->boxMin[i];
+	}
+	return 1;
+}
+
+// 解析一行原子数据, 成功时返回1; XYZ格式的id为原子在文件中的序号index
+static int parseAtom(const ConfFile* conf, struct SystemStr* sys, const char* line, bigint index, AtomData* atom){
+
+	const char* s = skipSpace(line);
+	char* end;
+
+	if (conf->lammps){
+		atom->id = strtoll(s, &end, 10);
+		if (end == s)
+			return 0;
+		s = end;
+		atom->type = (int)strtol(s, &end, 10) - 1;
+		if (end == s || atom->type < 0 || atom->type >= sys->lattice->typeNum)
+			return 0;
+		s = end;
+	}
+	else{
+		char name[8];
+		int len = 0;
+		while (s[len] && ! isspace((unsigned char)s[len]) && len < 7){
+			name[len] = s[len];
+			len++;
+		}
+		name[len] = '\0';
+		atom->id = index;
+		atom->type = -1;
+		for (int t = 0; t < sys->lattice->typeNum; t++)
+			if (strcmp(name, sys->lattice->atomName[t]) == 0)
+				atom->type = t;
+		if (atom->type < 0)
+			return 0;
+		s += len;
+	}
+
+	if (! parseCoord(conf, s, atom->pos))
+		return 0;
+	Spacial* space = sys->space;
+	for (int i = 0; i < 3; i++){
+		// 周期性维度上将坐标移入体系范围内
+		if (space->periodic[i])
+			atom->pos[i] -= space->globalLength[i]*floor(atom->pos[i]/space->globalLength[i]);
+		atom->momenta[i] = 0.0;
+	}
+	return 1;
+}
+
+// 本进程负责的一段原子数据[from, to), 所有进程一同调用
+// XYZ: 各进程先统计行数, 得到本段第一行的序号firstLine, 只读取前atomNum行(多帧文件只读第一帧)
+// LAMMPS: Atoms段在下一个段名(以字母开头的行)处结束
+static void confRange(const ConfFile* conf, size_t* begin, size_t* end, bigint* firstLine){
+
+	int rankNums = getRankNums();
+	int myRank = getMyRank();
+
+	size_t share = conf->size/rankNums, rest = conf->size%rankNums;
+	size_t from = lineStart(conf, share*myRank + rest*myRank/rankNums);
+	size_t to = lineStart(conf, share*(myRank+1) + rest*(myRank+1)/rankNums);
+	if (from < conf->begin)
+		from = conf->begin;
+	if (to < from)
+		to = from;
+
+	*firstLine = 0;
+	if (! conf->lammps){
+		bigint lines = 0;
+		for (const char* p = conf->data + from; p < conf->data + to
+			&& (p = memchr(p, '\n', conf->data + to - p)) != NULL; p++)
+			lines++;
+		MPI_Exscan(&lines, firstLine, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+		if (myRank == 0)
+			*firstLine = 0;
+	}
+	else{
+		unsigned long long sectionEnd = conf->size;
+		char buf[LINE_MAX_LENGTH];
+		for (size_t pos = from; pos < to; ){
+			size_t next = copyLine(conf, pos, buf);
+			if (isalpha((unsigned char)*skipSpace(buf))){
+				sectionEnd = pos;
+				break;
+			}
+			pos = next;
+		}
+		MPI_Allreduce(MPI_IN_PLACE, &sectionEnd, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, MPI_COMM_WORLD);
+		if (to > sectionEnd)
+			to = sectionEnd;
+		if (from > to)
+			from = to;
+	}
+	*begin = from;
+	*end = to;
+}
+
+// 第index行是否为原子数据: 跳过空行、注释行及XYZ文件第一帧之后的行
+static int atomLine(const ConfFile* conf, const char* s, bigint index){
+
+	return *s != '\0' && *s != '#' && (conf->lammps || index < conf->atomNum);
+}
+
+// 确定体系的范围, 所有进程一同调用; 文件头中没有给出范围时取defaultLength
+// 收缩包裹维度(boundary中为s)上有原子越出该范围时, 将该侧外移至原子之外margin处
+void fitConfBox(ConfFile* conf, const double* defaultLength, const char* boundary, double margin){
+
+	if (! conf->hasBox)
+		for (int i = 0; i < 3; i++){
+			conf->boxMin[i] = 0.0;
+			conf->boxLength[i] = defaultLength[i];
+		}
+
+	size_t from, to;
+	bigint index;
+	confRange(conf, &from, &to, &index);
+
+	// 各维度原子坐标的最小值及最大值的相反数, 格式错误的行留给loadConf报告
+	double extent[6];
+	for (int i = 0; i < 6; i++)
+		extent[i] = DBL_MAX;
+	char buf[LINE_MAX_LENGTH];
+	for (size_t pos = from; pos < to; index++)
+	{
+		pos = copyLine(conf, pos, buf);
+		const char* s = skipSpace(buf);
+		if (! atomLine(conf, s, index))
+			continue;
+
+		// 跳过原子序号及类型(LAMMPS)或元素名(XYZ)
+		for (int k = 0; k < (conf->lammps ? 2 : 1); k++){
+			s = skipSpace(s);
+			while (*s && ! isspace((unsigned char)*s))
+				s++;
+		}
+		double3 x;
+		if (! parseCoord(conf, s, x))
+			continue;
+		for (int d = 0; d < 3; d++){
+			if (x[d] < extent[2*d])
+				extent[2*d] = x[d];
+			if (-x[d] < extent[2*d+1])
+				extent[2*d+1] = -x[d];
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE, extent, 6, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+
+	for (int d = 0; d < 3; d++){
+		if (boundary[d] != 's' || extent[2*d] > -extent[2*d+1])
+			continue;
+		double lo = 0.0, hi = conf->boxLength[d];
+		if (extent[2*d] < lo)
+			lo = extent[2*d] - margin;
+		if (-extent[2*d+1] >= hi)
+			hi = -extent[2*d+1] + margin;
+		conf->boxMin[d] += lo;
+		conf->boxLength[d] = hi - lo;
+	}
+}
+
+// 解析本进程的一段原子数据, 将原子发送给所在空间的进程并放入细胞中, 所有进程一同调用
+// 返回1: 原子数据格式正确, 且读入的原子数与文件头一致; 0: 格式错误或原子数不一致;
+// -1: 有原子在固定边界维度上位于体系范围之外(个数由0号进程打印), 这些原子未读入
+int loadConf(ConfFile* conf, struct SystemStr* sys){
+
+	int rankNums = getRankNums();
+
+	size_t from, to;
+	bigint firstLine;
+	confRange(conf, &from, &to, &firstLine);
+
+	// 解析本段的原子并求各原子的属主进程
+	Spacial* space = sys->space;
+	int* p = space->globalProcNum;
+	int cap = 1024, num = 0, ok = 1;
+	bigint outside = 0;
+	AtomData* list = (AtomData*)malloc(cap*sizeof(AtomData));
+	int* owner = (int*)malloc(cap*sizeof(int));
+	char buf[LINE_MAX_LENGTH];
+	bigint index = firstLine;
+	for (size_t pos = from; pos < to; index++)
+	{
+		pos = copyLine(conf, pos, buf);
+		const char* s = skipSpace(buf);
+		if (! atomLine(conf, s, index))
+			continue;
+
+		if (num == cap){
+			cap *= 2;
+			list = (AtomData*)realloc(list, cap*sizeof(AtomData));
+			owner = (int*)realloc(owner, cap*sizeof(int));
+		}
+		if (! parseAtom(conf, sys, s, index, &list[num])){
+			ok = 0;
+			break;
+		}
+
+		// 周期性维度上的坐标已移入体系范围, 收缩包裹维度的范围已由fitConfBox扩大至包含所有原子
+		int in = 1;
+		for (int i = 0; i < 3; i++)
+			if (! space->periodic[i] && (list[num].pos[i] < 0.0 || list[num].pos[i] >= space->globalLength[i]))
+				in = 0;
+		if (! in){
+			outside++;
+			continue;
+		}
+		int3 layer;
+		for (int i = 0; i < 3; i++)
+			layer[i] = ownerLayer(space->planes[i], p[i], list[num].pos[i]);
+		owner[num] = layer[0] + p[0]*(layer[1] + p[1]*layer[2]);
+		num++;
+	}
+
+	// 按属主进程排列后全交换
+	int* sendCount = (int*)calloc(rankNums, sizeof(int));
+	int* recvCount = (int*)malloc(rankNums*sizeof(int));
+	int* sendDispl = (int*)malloc(rankNums*sizeof(int));
+	int* recvDispl = (int*)malloc(rankNums*sizeof(int));
+	for (int k = 0; k < num; k++)
+		sendCount[owner[k]]++;
+	MPI_Alltoall(sendCount, 1, MPI_INT, recvCount, 1, MPI_INT, MPI_COMM_WORLD);
+
+	int recvNum = 0;
+	for (int r = 0; r < rankNums; r++){
+		sendDispl[r] = r == 0 ? 0 : sendDispl[r-1] + sendCount[r-1];
+		recvDispl[r] = recvNum;
+		recvNum += recvCount[r];
+	}
+	AtomData* sendList = (AtomData*)malloc((num > 0 ? num : 1)*sizeof(AtomData));
+	for (int k = 0; k < num; k++)
+		sendList[sendDispl[owner[k]]++] = list[k];
+	for (int r = 0; r < rankNums; r++)
+		sendDispl[r] -= sendCount[r];
+	free(list);
+	free(owner);
+
+	MPI_Datatype atomType;
+	MPI_Type_contiguous(sizeof(AtomData), MPI_BYTE, &atomType);
+	MPI_Type_commit(&atomType);
+	AtomData* recvList = (AtomData*)malloc((recvNum > 0 ? recvNum : 1)*sizeof(AtomData));
+	MPI_Alltoallv(sendList, sendCount, sendDispl, atomType,
+		recvList, recvCount, recvDispl, atomType, MPI_COMM_WORLD);
+	MPI_Type_free(&atomType);
+	free(sendList);
+	free(sendCount);
+	free(recvCount);
+	free(sendDispl);
+	free(recvDispl);
+
+	placeAtoms(sys, recvList, recvNum);
+	free(recvList);
+
+	// 读入的原子数须与文件头一致
+	bigint myNum = sys->atoms->myNum;
+	MPI_Allreduce(&myNum, &sys->atoms->totalNum, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &outside, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+	if (ok && outside > 0){
+		if (ifZeroRank())
+			fprintf(stdout, "初始构型中有%lld个原子在固定边界维度上位于体系范围之外\n", (long long)outside);
+		return -1;
+	}
+	return ok && sys->atoms->totalNum == conf->atomNum;
+}
@@ -0,0 +1,47 @@
+// readconf.h
+// 从文件读取初始构型(XYZ或LAMMPS data格式), 代替distributeAtoms生成的晶格
+// 各进程将文件映射到内存后分别解析其中的一段字节, 再以全交换将原子发送给属主进程,
+// 任何进程都不读取整个文件
+
+#ifndef READCONF_H_
+#define READCONF_H_
+
+#include "mytype.h"
+
+#include <stddef.h>
+
+struct SystemStr;
+
+// 映射到内存的构型文件
+typedef struct ConfFileStr{
+
+	int lammps;       // 1为LAMMPS data格式, 0为XYZ格式
+	const char* data; // 文件内容的映射
+	size_t size;      // 文件的字节数
+	size_t begin;     // 原子数据第一行的起始位置
+
+	bigint atomNum;   // 文件头中的原子数
+	int hasBox;       // 文件头中是否给出了体系的范围
+	double3 boxMin;   // 体系的范围, 读入的坐标减去boxMin后为体系中的坐标, 体系为[0, boxLength)
+	double3 boxLength;
+
+}ConfFile;
+
+// 映射构型文件并解析文件头, 所有进程一同调用; format为xyz或lammps
+// format无法识别时返回0, 文件无法读取或文件头格式错误时返回-1
+// XYZ格式的范围取自第二行的Lattice="Lx 0 0 0 Ly 0 0 0 Lz"(extended XYZ), 没有时hasBox为0
+int openConf(const char* path, const char* format, ConfFile* conf);
+
+// 确定体系的范围, 在initSpace之前由所有进程一同调用; 文件头中没有给出范围时取defaultLength
+// 收缩包裹维度(boundary中为s)上有原子越出该范围时, 将该侧外移至原子之外margin处
+void fitConfBox(ConfFile* conf, const double* defaultLength, const char* boundary, double margin);
+
+// 解析本进程的一段原子数据, 将原子发送给所在空间的进程并放入细胞中, 所有进程一同调用
+// 返回1: 原子数据格式正确, 且读入的原子数与文件头一致; 0: 格式错误或原子数不一致;
+// -1: 有原子在固定边界维度上位于体系范围之外(个数由0号进程打印), 这些原子未读入
+int loadConf(ConfFile* conf, struct SystemStr* sys);
+
+// 解除映射
+void closeConf(ConfFile* conf);
+
+#endif
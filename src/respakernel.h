@@ -0,0 +1,102 @@
+// respakernel.h
+// 多时间步(r-RESPA)积分所用的对势作用力循环模板, 由potential.c多次包含
+// 对势以切换函数S(r)分为内层(快变)部分 S(r)E(r) 与外层(慢变)部分 (1-S(r))E(r):
+//   r < rIn-λ 时 S = 1, rIn-λ <= r < rIn 时 S = 1 + R²(2R-3), R = (r-rIn+λ)/λ, r >= rIn 时 S = 0
+// outer为0时只计算内层力, 只遍历 r < rIn 的原子对; outer为1时计算全部原子对,
+// 内层力写入作用力数组, 外层力写入pot.slowForce, 势能为完整的对势
+// 每次包含前需定义:
+//   RESPA_KERNEL_NAME           生成的函数名
+//   PAIR_EVAL(pot, ij, r2, e, fr)   与pairkernel.h相同
+// 本文件不设包含保护
+
+static void RESPA_KERNEL_NAME(struct SystemStr* sys, int outer){
+
+	const Potential pot = *sys->potential;
+	double rIn = pot.respaCutoff;
+	double width = pot.respaSwitch;
+	double rOn = rIn - width;
+	double rCut2 = outer ? pot.cutoff*pot.cutoff : rIn*rIn;
+	double rOn2 = rOn*rOn;
+	double3* slow = pot.slowForce;
+	int stencilNum = outer ? sys->cells->stencilNum : sys->cells->innerStencilNum;
+	int* stencil = outer ? sys->cells->stencil : sys->cells->innerStencil;
+
+	Cell* cells = sys->cells;
+	Atom* atoms = sys->atoms;
+
+   	for (int k1 = 0; k1<cells->activeNum; k1++)
+   	{
+      	int cell1 = cells->active[k1];
+      	int atomnum1 = cells->atomNum[cell1];
+      	if ( atomnum1 == 0 )
+      		continue;
+
+      	int pad1 = cells->cellToPad[cell1];
+
+   		// 内层步只遍历与内层截断球相交的邻居细胞
+   		for (int s = 0; s < stencilNum; s++)
+   				{
+   					int cell2 = cells->padToCell[pad1 + stencil[s]];
+
+   					int atomnum2 = cells->atomNum[cell2];
+   					if ( atomnum2 == 0 )
+      					continue;
+
+      				for (int n1=cells->cellStart[cell1],count1=0; count1<atomnum1; count1++,n1++)
+         			{
+         				int it1 = atoms->type[n1]*pot.typeNum;
+
+         				for (int n2=cells->cellStart[cell2],count2=0; count2<atomnum2; count2++,n2++)
+            			{
+           					if (cell2 < cells->myCellNum && n2 <= n1 )
+                  				continue; // 防止重复计算
+
+                  			double3 r_vector;
+           					double r2 = 0.0;
+                  			for (int i=0; i<3; i++)
+               				{
+                  				r_vector[i] = atoms->pos[n1][i]-atoms->pos[n2][i];
+                  				r2 += r_vector[i]*r_vector[i];
+               				}
+
+               				if ( r2 > rCut2 )
+               					continue;
+
+               				double e, fr;
+               				PAIR_EVAL(&pot, it1 + atoms->type[n2], r2, &e, &fr);
+
+               				// 内层部分: (SE)'/r = S*fr + S'*E/r
+               				double frFast = fr;
+               				if (r2 >= rIn*rIn)
+               					frFast = 0.0;
+               				else if (r2 > rOn2){
+               					double r = sqrt(r2);
+               					double R = (r - rOn)/width;
+               					double sw = 1.0 + R*R*(2.0*R - 3.0);
+               					double dsw = 6.0*R*(R - 1.0)/width;
+               					frFast = sw*fr + dsw*e/r;
+               				}
+
+              				for (int m=0; m<3; m++)
+               				{
+                  				atoms->force[n1][m] -= r_vector[m]*frFast;
+                  				atoms->force[n2][m] += r_vector[m]*frFast;
+               				}
+               				if (outer){
+               					double frSlow = fr - frFast;
+               					for (int m=0; m<3; m++)
+               					{
+                  					slow[n1][m] -= r_vector[m]*frSlow;
+                  					slow[n2][m] += r_vector[m]*frSlow;
+               					}
+               					atoms->pot[n1] += 0.5*e;
+               					atoms->pot[n2] += 0.5*e;
+               				}
+   						}
+            		}
+         		}
+    }
+}
+
+#undef RESPA_KERNEL_NAME
+#undef PAIR_EVAL
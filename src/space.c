@@ -3,10 +3,12 @@
 #include "error.h"
 #include "parameter.h"
 #include "lattice.h"
+#include "cell.h"
 #include <stdlib.h>
+#include <string.h>
 
 // 空间分解，将模拟的体系分解成若干个部分，每个部分由一个进程处理
-void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, struct SpacialStr** spa){
+void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, double cutoff, const double* boxLength, struct SpacialStr** spa){
 	
 	int myRank = getMyRank();
 
@@ -15,19 +17,49 @@ void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, struct Spa
 	globalLength[0] = para->xLat *lattice->latticeConst;
 	globalLength[1] = para->yLat *lattice->latticeConst;
 	globalLength[2] = para->zLat *lattice->latticeConst;
+	if (boxLength)
+		for (int i = 0; i < 3; i++)
+			globalLength[i] = boxLength[i];
+
+	int3 grid = {para->xProc, para->yProc, para->zProc};
 
 	// 进程xyz参数错误
-	if(para->xProc * para->yProc * para->zProc != getRankNums()){
+	if(grid[0] > 0 && grid[1] > 0 && grid[2] > 0 &&
+		grid[0] * grid[1] * grid[2] != getRankNums()){
 		errorInfo(procNum);
 		exit(procNum);
 	}
 
+	// 自动选择未指定的维度
+	if(! chooseProcGrid(getRankNums(), globalLength, cutoff, grid)){
+		errorInfo(procGrid);
+		exit(procGrid);
+	}
+	para->xProc = grid[0];
+	para->yProc = grid[1];
+	para->zProc = grid[2];
+
 	*spa = (Spacial*)malloc(sizeof(Spacial));
 	Spacial* space = *spa;
+
+	// 各维度的边界条件
+	if (strlen(para->boundary) != 3){
+		errorInfo(boundary);
+		exit(boundary);
+	}
+	for (int i = 0; i < 3; i++){
+		char b = para->boundary[i];
+		if (b != 'p' && b != 'f' && b != 's'){
+			errorInfo(boundary);
+			exit(boundary);
+		}
+		space->periodic[i] = b == 'p';
+		space->shrinkWrap[i] = b == 's';
+	}
 	
-	space->globalProcNum[0] = para->xProc;
-	space->globalProcNum[1] = para->yProc;
-	space->globalProcNum[2] = para->zProc;
+	space->globalProcNum[0] = grid[0];
+	space->globalProcNum[1] = grid[1];
+	space->globalProcNum[2] = grid[2];
 
 	//计算本进程对应的空间在体系中的位置
 	
@@ -43,11 +75,78 @@ void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, struct Spa
       	space->globalMax[i] = globalLength[i];
       	space->globalLength[i] = space->globalMax[i] - space->globalMin[i];
    	}
+
+   	// 初始时各空间等分
    	for (int i = 0; i < 3; i++)
    	{
-      	space->myLength[i] = space->globalLength[i] / space->globalProcNum[i];
-      	space->myMin[i] = space->globalMin[i] +  space->position[i]    * space->myLength[i];
-      	space->myMax[i] = space->globalMin[i] + (space->position[i]+1) * space->myLength[i];
+   		int procNum = space->globalProcNum[i];
+   		space->planes[i] = (double*)malloc((procNum+1)*sizeof(double));
+   		for (int k = 0; k <= procNum; k++)
+   			space->planes[i][k] = space->globalMin[i] + k*space->globalLength[i]/procNum;
+   		// 保证两端与体系边界完全一致
+   		space->planes[i][procNum] = space->globalMax[i];
    	}
+   	updateSpaceBounds(space);
+
+}
+
+// 根据分界面坐标更新本进程空间的范围
+void updateSpaceBounds(Spacial* space){
+
+   	for (int i = 0; i < 3; i++)
+   	{
+      	space->myMin[i] = space->planes[i][space->position[i]];
+      	space->myMax[i] = space->planes[i][space->position[i]+1];
+      	space->myLength[i] = space->myMax[i] - space->myMin[i];
+   	}
+}
+
+// 将进程总数分解到三个维度上, procNum中大于0的维度保持不变, 其余维度自动选择
+// 每个空间的通信区域为其外侧一层厚度为一个细胞长度的壳层, 在各维度至少MINCELLS个细胞的分解中选择壳层体积最小的
+int chooseProcGrid(int rankNums, double3 globalLength, double cutoff, int3 procNum){
+
+	int3 best = {0, 0, 0};
+	double bestVolume = 0.0;
+
+	for (int px = 1; px <= rankNums; px++){
+		if (rankNums % px != 0 || (procNum[0] > 0 && px != procNum[0]))
+			continue;
+		for (int py = 1; py <= rankNums/px; py++){
+			if ((rankNums/px) % py != 0 || (procNum[1] > 0 && py != procNum[1]))
+				continue;
+			int pz = rankNums/(px*py);
+			if (procNum[2] > 0 && pz != procNum[2])
+				continue;
+
+			int3 p = {px, py, pz};
+			double inner = 1.0;
+			double outer = 1.0;
+			int ok = 1;
+			for (int i = 0; i < 3; i++){
+				double length = globalLength[i]/p[i];
+				int cellNum = (int)(length/cutoff);
+				if (cellNum < MINCELLS)
+					ok = 0;
+				inner *= length;
+				outer *= length + 2.0*(cellNum > 0 ? length/cellNum : length);
+			}
+			if (! ok)
+				continue;
+
+			// 通信区域的体积, 体积相同时保持先找到的分解
+			double volume = outer - inner;
+			if (best[0] == 0 || volume < bestVolume*(1.0 - 1e-12)){
+				best[0] = px;
+				best[1] = py;
+				best[2] = pz;
+				bestVolume = volume;
+			}
+		}
+	}
 
-}
\ No newline at end of file
+	if (best[0] == 0)
+		return 0;
+	for (int i = 0; i < 3; i++)
+		procNum[i] = best[i];
+	return 1;
+}
@@ -21,12 +21,26 @@ typedef struct SpacialStr{
 	double3 globalMax; //整个体系坐标最大值
 	double3 globalLength; //整个体系的长度
 
+	int3 periodic;   // 各维度是否为周期性边界; 非周期性维度两端的进程在该侧没有邻居
+	int3 shrinkWrap; // 各维度是否为收缩包裹边界: 原子越出体系时该侧的边界随之外移
+
 	int3 globalProcNum; // 各坐标轴上分解的空间数
 	int3 position; // 本进程对应的空间位置
+
+	double* planes[3]; // 各坐标轴上各空间的分界面坐标, 长度为该轴进程数+1, 同一层的进程共用
 }Spacial;
 
 // 空间分解，将模拟的体系分解成若干个部分，每个部分由一个进程处理
-void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, struct SpacialStr** spa);
+// 未指定的维度上的进程数由chooseProcGrid自动选择
+// boxLength为体系各方向的长度, 为NULL时由晶格数和晶格常数决定
+void initSpace(struct ParameterStr* para, struct LatticeStr* lattice, double cutoff, const double* boxLength, struct SpacialStr** spa);
+
+// 将进程总数分解到三个维度上, procNum中大于0的维度保持不变, 其余维度自动选择,
+// 在各空间每个维度至少有MINCELLS个细胞的前提下使通信区域的体积最小, 无可行分解时返回0
+int chooseProcGrid(int rankNums, double3 globalLength, double cutoff, int3 procNum);
+
+// 根据分界面坐标更新本进程空间的范围
+void updateSpaceBounds(Spacial* space);
 
 
 #endif
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "system.h"
+#include "error.h"
+#include "memory.h"
+#include "affinity.h"
+#include "readconf.h"
+#include "mympi.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <float.h>
 #include <mpi.h>
 
 //初始化模拟体系
@@ -10,17 +16,86 @@ System* initSystem(Parameter* para){
 
 	System* sys = (System*)malloc(sizeof(System));
 	memset(sys, 0, sizeof(System));
+	for (int i = 0; i < 3; i++){
+		sys->atomMin[i] = DBL_MAX;
+		sys->atomMax[i] = -DBL_MAX;
+	}
 
     initEnergy(&sys->energy);
-   	initPotInfo(&sys->potential);
+   	initLatticeInfo(&sys->lattice, para);
+   	initPotInfo(&sys->potential, para, sys->lattice);
     printPotential(stdout, sys->potential);
-   	initLatticeInfo(&sys->lattice);
     //printLattice(stdout, sys->lattice);
-    initSpace(para, sys->lattice, &sys->space);
-    initCells(sys->space, sys->potential, &sys->cells);
+
+    // 从文件读取初始构型时, 体系的范围优先取自文件头
+    ConfFile conf;
+    int fromFile = strcmp(para->initFile, "none") != 0;
+    if (fromFile){
+    	int opened = openConf(para->initFile, para->initFormat, &conf);
+    	if (opened == 0){
+    		errorInfo(initFormat);
+    		exit(initFormat);
+    	}
+    	if (opened < 0){
+    		errorInfo(initFile);
+    		exit(initFile);
+    	}
+    	double3 latticeLength = {para->xLat*sys->lattice->latticeConst,
+    		para->yLat*sys->lattice->latticeConst, para->zLat*sys->lattice->latticeConst};
+    	fitConfBox(&conf, latticeLength, para->boundary, sys->potential->cutoff);
+    }
+    initSpace(para, sys->lattice, sys->potential->cutoff,
+    	fromFile ? conf.boxLength : NULL, &sys->space);
+
+    // 进程网格确定后绑定各进程, 之后分配的原子数组由绑定后的处理器首次写入
+    if (! bindRanks(para->affinity, sys->space)){
+    	errorInfo(affinity);
+    	exit(affinity);
+    }
+    if (strcmp(para->rebinMode, "move") == 0)
+    	sys->sortRebin = 0;
+    else if (strcmp(para->rebinMode, "sort") == 0)
+    	sys->sortRebin = 1;
+    else{
+    	errorInfo(rebinMode);
+    	exit(rebinMode);
+    }
+
+    int mortonOrder = 0;
+    if (strcmp(para->cellOrder, "morton") == 0)
+    	mortonOrder = 1;
+    else if (strcmp(para->cellOrder, "xyz") != 0){
+    	errorInfo(cellOrder);
+    	exit(cellOrder);
+    }
+    sys->sortInterval = para->sortInterval;
+
+    // 原子数组所用的页须在分配之前设置
+    if (! setPageMode(para->hugePages)){
+    	errorInfo(hugePages);
+    	exit(hugePages);
+    }
+    sys->tileSize = para->tileSize;
+
+    initCells(sys->space, sys->potential, para->cellDivision, mortonOrder, &sys->cells);
     initAtoms(sys->cells, &sys->atoms);
 
-    distributeAtoms(sys, para);
+    if (fromFile){
+    	int loaded = loadConf(&conf, sys);
+    	if (loaded < 0){
+    		errorInfo(initRange);
+    		exit(initRange);
+    	}
+    	if (loaded == 0){
+    		errorInfo(initFile);
+    		exit(initFile);
+    	}
+    	closeConf(&conf);
+    }
+    else
+    	distributeAtoms(sys, para);
+    tileCells(sys->cells, sys->tileSize, (double)sys->atoms->myNum/sys->cells->myCellNum);
+    printSpace(stdout, sys->space, sys->cells);
     initTemperature(sys, para);
 
     initComm(&sys->datacomm, sys->space, sys->cells);
@@ -28,6 +103,8 @@ System* initSystem(Parameter* para){
     
     sys->smBuf = NULL;
     sys->usrBuf = NULL;
+    allocCommWindows(sys);
+    reportMemory(sys, "初始化");
     //MPI_Allreduce(&sys->atoms->myNum, &sys->atoms->totalNum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
     //printTotalAtom(stdout,sys->atoms);
 
@@ -35,4 +112,110 @@ System* initSystem(Parameter* para){
 
 
     return sys;
-}
\ No newline at end of file
+}
+
+// 按当前的细胞划分分配两个共享内存窗口, 所有进程取相同的大小
+// 各进程窗口大小相同时, 逆向传递的数据量(每个原子不超过半个AtomData)不会超出窗口
+void allocCommWindows(System* sys){
+
+	DataComm* comm = sys->datacomm;
+	int size[2] = {comm->smBufSize, comm->bufSize};
+	MPI_Allreduce(MPI_IN_PLACE, size, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	comm->smBufSize = size[0];
+	comm->bufSize = size[1];
+
+	MPI_Win_allocate_shared(comm->smBufSize+6*sizeof(int), sizeof(char),
+          sharedWinInfo(),MPI_COMM_WORLD, &sys->smBuf, &sys->win1);
+	MPI_Win_allocate_shared(comm->bufSize+2*sizeof(int), sizeof(char),
+          sharedWinInfo(),MPI_COMM_WORLD, &sys->usrBuf, &sys->win2);
+	memset(sys->smBuf, 0, 6*sizeof(int));
+	memset(sys->usrBuf, 0, 2*sizeof(int));
+}
+
+// 释放共享内存窗口
+void freeCommWindows(System* sys){
+
+	MPI_Win_free(&sys->win1);
+	MPI_Win_free(&sys->win2);
+	sys->smBuf = NULL;
+	sys->usrBuf = NULL;
+}
+
+// 检查本进程的数据能否写入两个共享内存窗口(不含头部), 只在本地判断, 不进行通信
+// 能写入时返回1; 否则在不足的窗口头部首个整数处写入所需字节数的相反数作为扩容请求并返回0,
+// 调用者此时不写入数据, 在随后的窗口同步之后调用growCommWindows
+int reserveCommWindows(System* sys, int smBytes, int usrBytes){
+
+	DataComm* comm = sys->datacomm;
+	int fits = 1;
+	if (smBytes > comm->smBufSize){
+		int request = -smBytes;
+		memcpy(sys->smBuf, &request, sizeof(int));
+		fits = 0;
+	}
+	if (usrBytes > comm->bufSize){
+		int request = -usrBytes;
+		memcpy(sys->usrBuf, &request, sizeof(int));
+		fits = 0;
+	}
+	return fits;
+}
+
+// 按bytes字节(不含头部)重新分配一个共享内存窗口, 保留本进程原有的内容
+static void regrowWindow(MPI_Win* win, char** buf, int oldBytes, int bytes, int header){
+
+	MPI_Win newWin;
+	char* newBuf = NULL;
+	MPI_Win_allocate_shared(bytes+header, sizeof(char),
+		sharedWinInfo(),MPI_COMM_WORLD, &newBuf, &newWin);
+	memcpy(newBuf, *buf, oldBytes+header);
+	MPI_Win_free(win);
+	*win = newWin;
+	*buf = newBuf;
+}
+
+// 在窗口同步(MPI_Win_fence)之后由所有进程一同调用, 读取所有进程窗口头部的扩容请求
+// 有请求时所有进程按最大需求的1.25倍一同重新分配该窗口, 返回是否进行了扩容
+// 请求只在数据超出窗口时出现, 通常只读取共享内存而没有额外的集合通信
+int growCommWindows(System* sys){
+
+	DataComm* comm = sys->datacomm;
+	int need[2] = {0, 0};
+	for (int rank=0; rank<getRankNums(); rank++){
+		int header[2];
+		memcpy(&header[0], neighborBuf(sys->win1, rank), sizeof(int));
+		memcpy(&header[1], neighborBuf(sys->win2, rank), sizeof(int));
+		for (int i=0; i<2; i++)
+			if (-header[i] > need[i])
+				need[i] = -header[i];
+	}
+
+	if (need[0] > 0){
+		int bytes = need[0] + need[0]/4;
+		regrowWindow(&sys->win1, &sys->smBuf, comm->smBufSize, bytes, 6*sizeof(int));
+		comm->smBufSize = bytes;
+	}
+	if (need[1] > 0){
+		int bytes = need[1] + need[1]/4;
+		regrowWindow(&sys->win2, &sys->usrBuf, comm->bufSize, bytes, 2*sizeof(int));
+		comm->bufSize = bytes;
+	}
+	return need[0] > 0 || need[1] > 0;
+}
+
+// 统计所有进程的原子数组槽位及其占用的内存(包括共享内存窗口), 打印每个原子的平均值
+void reportMemory(System* sys, const char* stage){
+
+	Cell* cells = sys->cells;
+	double slotBytes = 3*sizeof(double3) + sizeof(double) + sizeof(bigint) + sizeof(int) + 3*sizeof(float);
+	if (sys->potential->eam)
+		slotBytes += 2*sizeof(double);
+
+	double mem[2];
+	mem[0] = cells->slotNum;
+	mem[1] = cells->slotNum*slotBytes + sys->datacomm->smBufSize + sys->datacomm->bufSize
+		+ (cells->totalCellNum*3 + cells->padCellNum[0]*cells->padCellNum[1]*cells->padCellNum[2])*sizeof(int);
+	MPI_Allreduce(MPI_IN_PLACE, mem, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+	printMemory(stdout, stage, mem[0]/sys->atoms->totalNum, mem[1]/sys->atoms->totalNum);
+}
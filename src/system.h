@@ -13,6 +13,7 @@
 #include "info.h"
 #include "energy.h"
 #include "datacomm.h"
+#include "cluster.h"
 
 #include <mpi.h>
 
@@ -33,6 +34,16 @@ typedef struct SystemStr
 
    	Atom* atoms;          // 存储原子的相关信息数据
 
+   	int sortRebin;        // 调整原子所在细胞时, 为1则对本空间所有原子计数排序, 为0则逐个移动
+   	int sortInterval;     // 每调整多少次原子所在细胞后, 将各细胞内的原子按位置排序, 0为不排序
+   	int tileSize;         // 作用力计算分块的细胞数, 0为自动选择
+   	bigint lostNum;       // 越过固定边界而丢弃的原子累计数
+   	double3 atomMin;      // 上次位置更新后本空间原子坐标的最小值及最大值
+   	double3 atomMax;
+   	int boxCrossed;       // 上次原子交换时是否有原子越出收缩包裹边界, 为1时由expandBox外移边界
+
+   	ClusterList* clusters; // 簇对作用力计算所用的原子簇, 未使用时为NULL
+
    	char* smBuf ;	// 共享缓冲区起始地址
 	char* usrBuf;
 		
@@ -44,4 +55,19 @@ typedef struct SystemStr
 //初始化模拟体系
 System* initSystem();
 
+// 按当前的细胞划分分配两个共享内存窗口
+void allocCommWindows(System* sys);
+
+// 释放共享内存窗口
+void freeCommWindows(System* sys);
+
+// 打印每个原子平均占用的槽位数及内存, stage为统计时所处的阶段
+void reportMemory(System* sys, const char* stage);
+
+// 本地检查共享内存窗口能否容纳指定字节数的数据, 不足时在窗口头部留下扩容请求并返回0
+int reserveCommWindows(System* sys, int smBytes, int usrBytes);
+
+// 窗口同步之后由所有进程调用, 有进程请求扩容时一同重新分配窗口并返回1
+int growCommWindows(System* sys);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "table.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// 在 r² = u 处求势能与 (dE/dr)/r
+static void evalAtR2(PairFunc func, void* arg, double u, double* e, double* fr){
+
+	double r = sqrt(u);
+	double dedr;
+	func(arg, r, e, &dedr);
+	*fr = dedr/r;
+}
+
+// 由对势函数生成插值表, 截断处的势能被平移为0
+// 三次插值采用Hermite形式, 节点处的导数(对u=r²)由中心差分求得
+PotTable* buildPotTable(PairFunc func, void* arg, double rMin, double rCut, int n, int cubic){
+
+	PotTable* table = (PotTable*)malloc(sizeof(PotTable));
+
+	table->n = n;
+	table->cubic = cubic;
+	table->stride = cubic ? 8 : 4;
+	table->r2Min = rMin*rMin;
+	table->r2Max = rCut*rCut;
+	double du = (table->r2Max - table->r2Min)/n;
+	table->invDr2 = 1.0/du;
+	table->coef = (double*)malloc(n*table->stride*sizeof(double));
+
+	double eCut, frCut;
+	evalAtR2(func, arg, table->r2Max, &eCut, &frCut);
+
+	// 各节点处的值与导数
+	double* e = (double*)malloc((n+1)*sizeof(double));
+	double* fr = (double*)malloc((n+1)*sizeof(double));
+	double* de = (double*)malloc((n+1)*sizeof(double));
+	double* dfr = (double*)malloc((n+1)*sizeof(double));
+	double h = 1.0e-3*du;
+	for (int i = 0; i <= n; i++)
+	{
+		double u = table->r2Min + i*du;
+		double ep, em, fp, fm;
+		evalAtR2(func, arg, u, &e[i], &fr[i]);
+		evalAtR2(func, arg, u+h, &ep, &fp);
+		evalAtR2(func, arg, u-h, &em, &fm);
+		e[i] -= eCut;
+		de[i] = (ep - em)/(2.0*h)*du;   // 对t的导数
+		dfr[i] = (fp - fm)/(2.0*h)*du;
+	}
+
+	for (int k = 0; k < n; k++)
+	{
+		double* c = table->coef + k*table->stride;
+		if (cubic){
+			// p(t) = y0 + m0 t + (3(y1-y0) - 2m0 - m1) t² + (2(y0-y1) + m0 + m1) t³
+			c[0] = e[k];
+			c[1] = de[k];
+			c[2] = 3.0*(e[k+1]-e[k]) - 2.0*de[k] - de[k+1];
+			c[3] = 2.0*(e[k]-e[k+1]) + de[k] + de[k+1];
+			c[4] = fr[k];
+			c[5] = dfr[k];
+			c[6] = 3.0*(fr[k+1]-fr[k]) - 2.0*dfr[k] - dfr[k+1];
+			c[7] = 2.0*(fr[k]-fr[k+1]) + dfr[k] + dfr[k+1];
+		}
+		else{
+			c[0] = e[k];
+			c[1] = e[k+1] - e[k];
+			c[2] = fr[k];
+			c[3] = fr[k+1] - fr[k];
+		}
+	}
+
+	free(e);
+	free(fr);
+	free(de);
+	free(dfr);
+	return table;
+}
+
+// 释放插值表
+void freePotTable(PotTable* table){
+	if (table){
+		free(table->coef);
+		free(table);
+	}
+}
+
+// 插值表占用的字节数
+int potTableBytes(PotTable* table){
+	return table->n*table->stride*sizeof(double);
+}
+
+// 由数据点(x单调递增)构造自然三次样条, 数据被复制
+PairSpline* makePairSpline(int num, const double* x, const double* y){
+
+	PairSpline* sp = (PairSpline*)malloc(sizeof(PairSpline));
+	sp->num = num;
+	sp->r = (double*)malloc(num*sizeof(double));
+	sp->e = (double*)malloc(num*sizeof(double));
+	sp->d2 = (double*)malloc(num*sizeof(double));
+	memcpy(sp->r, x, num*sizeof(double));
+	memcpy(sp->e, y, num*sizeof(double));
+
+	// 求解三对角方程组得到各点二阶导数, 两端二阶导数为0
+	double* u = (double*)malloc(num*sizeof(double));
+	sp->d2[0] = u[0] = 0.0;
+	for (int i = 1; i < num-1; i++)
+	{
+		double sig = (sp->r[i]-sp->r[i-1])/(sp->r[i+1]-sp->r[i-1]);
+		double p = sig*sp->d2[i-1] + 2.0;
+		sp->d2[i] = (sig - 1.0)/p;
+		u[i] = (sp->e[i+1]-sp->e[i])/(sp->r[i+1]-sp->r[i])
+			- (sp->e[i]-sp->e[i-1])/(sp->r[i]-sp->r[i-1]);
+		u[i] = (6.0*u[i]/(sp->r[i+1]-sp->r[i-1]) - sig*u[i-1])/p;
+	}
+	sp->d2[num-1] = 0.0;
+	for (int i = num-2; i >= 0; i--)
+		sp->d2[i] = sp->d2[i]*sp->d2[i+1] + u[i];
+	free(u);
+
+	return sp;
+}
+
+// 释放样条
+void freePairSpline(PairSpline* sp){
+	if (sp){
+		free(sp->r);
+		free(sp->e);
+		free(sp->d2);
+		free(sp);
+	}
+}
+
+// 从文件中读取对势数据, 每行"r E", #开头为注释; 失败时返回NULL
+PairSpline* readPairSpline(const char* path){
+
+	FILE* f = fopen(path, "r");
+	if (f == NULL)
+		return NULL;
+
+	int num = 0, cap = 256;
+	double* r = (double*)malloc(cap*sizeof(double));
+	double* e = (double*)malloc(cap*sizeof(double));
+
+	char line[256];
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		double x, y;
+		if (line[0] == '#' || sscanf(line, "%lf %lf", &x, &y) != 2)
+			continue;
+		if (num == cap){
+			cap *= 2;
+			r = (double*)realloc(r, cap*sizeof(double));
+			e = (double*)realloc(e, cap*sizeof(double));
+		}
+		r[num] = x;
+		e[num] = y;
+		num++;
+	}
+	fclose(f);
+
+	// 距离须严格递增
+	int sorted = 1;
+	for (int i = 1; i < num; i++)
+		if (r[i] <= r[i-1])
+			sorted = 0;
+
+	PairSpline* sp = NULL;
+	if (num >= 4 && sorted)
+		sp = makePairSpline(num, r, e);
+
+	free(r);
+	free(e);
+	return sp;
+}
+
+// 样条对势的求值函数, 可作为PairFunc使用
+void pairSplineEval(void* arg, double r, double* e, double* dedr){
+
+	PairSpline* sp = (PairSpline*)arg;
+
+	// 二分查找所在区间, 超出范围时按端点区间外推
+	int lo = 0, hi = sp->num - 1;
+	while (hi - lo > 1)
+	{
+		int mid = (lo + hi)/2;
+		if (sp->r[mid] > r)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	double h = sp->r[hi] - sp->r[lo];
+	double a = (sp->r[hi] - r)/h;
+	double b = (r - sp->r[lo])/h;
+	*e = a*sp->e[lo] + b*sp->e[hi]
+		+ ((a*a*a - a)*sp->d2[lo] + (b*b*b - b)*sp->d2[hi])*h*h/6.0;
+	*dedr = (sp->e[hi] - sp->e[lo])/h
+		- (3.0*a*a - 1.0)/6.0*h*sp->d2[lo] + (3.0*b*b - 1.0)/6.0*h*sp->d2[hi];
+}
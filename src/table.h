@@ -0,0 +1,79 @@
+// table.h
+// 势函数插值表：在r²上等间距地预先计算势能和力，计算力时通过线性或三次插值求值
+
+#ifndef TABLE_H_
+#define TABLE_H_
+
+// 插值表的起点(Angstrom), 小于此距离时按起点处的值计算
+#define TABLE_RMIN 1.0
+
+// 对势函数: 给定距离r，求势能e及其导数dE/dr
+typedef void (*PairFunc)(void* arg, double r, double* e, double* dedr);
+
+typedef struct PotTableStr{
+
+	int n;          // 插值区间数
+	int cubic;      // 1: 三次插值; 0: 线性插值
+	int stride;     // 每个区间的系数个数(势能与力各占一半)
+	double r2Min;   // 表格起点 r²
+	double r2Max;   // 表格终点 r², 即截断距离的平方
+	double invDr2;  // 1/Δ(r²)
+	double* coef;   // 各区间的多项式系数, 依次为势能和 (dE/dr)/r 关于 t 的系数, t∈[0,1)
+
+}PotTable;
+
+// 由文件读入的对势数据(r, E)，经三次样条插值后作为对势函数使用
+typedef struct PairSplineStr{
+
+	int num;        // 数据点数
+	double* r;      // 距离
+	double* e;      // 势能
+	double* d2;     // 样条二阶导数
+
+}PairSpline;
+
+// 由对势函数生成插值表, 截断处的势能被平移为0
+PotTable* buildPotTable(PairFunc func, void* arg, double rMin, double rCut, int n, int cubic);
+
+// 释放插值表
+void freePotTable(PotTable* table);
+
+// 插值表占用的字节数
+int potTableBytes(PotTable* table);
+
+// 由数据点(x单调递增)构造自然三次样条, 数据被复制
+PairSpline* makePairSpline(int num, const double* x, const double* y);
+
+// 释放样条
+void freePairSpline(PairSpline* sp);
+
+// 从文件中读取对势数据, 每行"r E", #开头为注释, r须严格递增; 失败时返回NULL
+// 最后一个数据点的距离即为该对势的截断距离
+PairSpline* readPairSpline(const char* path);
+
+// 样条对势的求值函数, 可作为PairFunc使用
+void pairSplineEval(void* arg, double r, double* e, double* dedr);
+
+// 插值求势能 e 和 (dE/dr)/r
+static inline void potTableEval(const PotTable* table, double r2, double* e, double* fr){
+
+	double x = (r2 - table->r2Min)*table->invDr2;
+	if (x < 0.0)
+		x = 0.0;
+	int k = (int)x;
+	if (k >= table->n)
+		k = table->n - 1;
+	double t = x - k;
+	const double* c = table->coef + k*table->stride;
+
+	if (table->cubic){
+		*e  = c[0] + t*(c[1] + t*(c[2] + t*c[3]));
+		*fr = c[4] + t*(c[5] + t*(c[6] + t*c[7]));
+	}
+	else{
+		*e  = c[0] + t*c[1];
+		*fr = c[2] + t*c[3];
+	}
+}
+
+#endif
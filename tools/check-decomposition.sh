@@ -0,0 +1,50 @@
+#!/bin/bash
+# check-decomposition.sh
+# 检查区域分解不改变计算结果: 同一体系分别以1个进程和多种进程网格运行, 比较最后一步的每原子能量
+# 13个晶胞在x方向分给3个进程时分界面不在晶格面之间的中点, 高温下原子频繁跨越分界面及进程网格的棱角
+# 6x2x1的网格中每个进程在x方向上只有1个细胞
+# 用法: tools/check-decomposition.sh [md-mpi路径], 环境变量MPIRUN可指定启动命令(如 "mpirun --oversubscribe")
+
+BIN=$(realpath "${1:-./bin/md-mpi}")
+MPIRUN=${MPIRUN:-mpirun}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/parameter" <<P
+potentialName=default
+xLatticeNum=13
+yLatticeNum=12
+zLatticeNum=12
+stepNums=30
+printNums=30
+stepTime=1.0
+initialTemperature=1500
+P
+
+# 运行一次, 输出最后一步的每原子势能及总能量
+energy(){
+	local np=$1; shift
+	(cd "$DIR" && $MPIRUN -np $np "$BIN" --input="$DIR/parameter" "$@" 2>&1) | grep "每原子总能量" | tail -n 1
+}
+
+fail=0
+for options in "" "--newton=1" "--balanceInterval=5" "--boundary=sss" "--forceEngine=cluster"; do
+
+	ref=$(energy 1 --xProcessNum=1 --yProcessNum=1 --zProcessNum=1 $options)
+	if [ -z "$ref" ]; then
+		echo "FAIL [$options] 1x1x1: 运行失败"
+		fail=1
+		continue
+	fi
+	for grid in "3 2 1" "2 2 2" "6 2 1"; do
+		set -- $grid
+		out=$(energy $(($1*$2*$3)) --xProcessNum=$1 --yProcessNum=$2 --zProcessNum=$3 $options)
+		if [ "$out" == "$ref" ]; then
+			echo "ok   [$options] $1x$2x$3"
+		else
+			echo "FAIL [$options] $1x$2x$3: $out, 1x1x1: $ref"
+			fail=1
+		fi
+	done
+done
+exit $fail